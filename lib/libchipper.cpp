@@ -0,0 +1,147 @@
+#include "libchipper.h"
+#include "chip8.h"
+#include <new>
+#include <cstdlib>
+#include <cstring>
+
+//the core reads these, chipper defines them in game.cpp
+bool DEBUG_MODE = false;
+bool FIND_MODE = false;
+
+static_assert(CHIPPER_SCREEN_BYTES == sizeof(((chipState *)0)->display), "screen layout");
+static_assert(CHIPPER_MEMORY_BYTES == sizeof(((chipState *)0)->memory), "memory layout");
+
+struct chipper {
+  Chip8 cpu;
+  chipState blank; //fresh machine, for loading another ROM
+  chipState start; //right after load, for chipper_reset
+  double opsPerFrame;
+  double opsOwed;
+  uint32_t frames;
+  uint8_t status;
+};
+
+int chipper_abi_version(void) {
+  return CHIPPER_ABI_VERSION;
+}
+
+chipper *chipper_create(uint32_t seed) {
+  //chipState wants 64 byte alignment, which new doesn't promise before C++17
+  void *block = NULL;
+  if(posix_memalign(&block, 64, sizeof(chipper)))
+    return NULL;
+  chipper *c = new(block) chipper;
+  chipState s = c->cpu.getState();
+  s.rng = seed | 1; //xorshift must never be 0
+  c->cpu.setState(s);
+  c->blank = s;
+  c->start = s;
+  c->opsPerFrame = 800 / 60.0;
+  c->opsOwed = 0;
+  c->frames = 0;
+  c->status = CHIPPER_RUNNING;
+  return c;
+}
+
+void chipper_destroy(chipper *c) {
+  if(!c)
+    return;
+  c->~chipper();
+  free(c);
+  return;
+}
+
+int chipper_load_rom(chipper *c, const uint8_t *rom, size_t size) {
+  if(size > 0xE00)
+    return -1;
+  c->cpu.setState(c->blank);
+  if(c->cpu.loadROM(rom, (int)size))
+    return -1;
+  c->start = c->cpu.getState();
+  c->opsOwed = 0;
+  c->frames = 0;
+  c->status = CHIPPER_RUNNING;
+  return 0;
+}
+
+void chipper_reset(chipper *c) {
+  c->cpu.setState(c->start);
+  c->opsOwed = 0;
+  c->frames = 0;
+  c->status = CHIPPER_RUNNING;
+  return;
+}
+
+void chipper_set_speed(chipper *c, int opsPerSec) {
+  c->opsPerFrame = opsPerSec > 0 ? opsPerSec / 60.0 : 0;
+  return;
+}
+
+static void stepOne(chipper *c, uint16_t keys, int frames) {
+  c->cpu.setKeys(keys);
+  for(int f = 0; f < frames && c->status == CHIPPER_RUNNING; f++) {
+    c->opsOwed += c->opsPerFrame;
+    int ops = (int)c->opsOwed;
+    c->opsOwed -= ops;
+    switch(c->cpu.executeOps(ops)) {
+      case chip_exit:
+        c->status = CHIPPER_EXITED;
+        break;
+      case chip_oob:
+        c->status = CHIPPER_FAULT;
+        break;
+      default:
+        c->cpu.timerTick();
+        c->frames++;
+        break;
+    }
+  }
+  return;
+}
+
+int chipper_step_frames(chipper **handles, int n, const uint16_t *keys, int frames,
+                        uint8_t *screens, chipper_regs *regs, uint8_t *memory) {
+  int running = 0;
+  //one instance at a time, all its frames, so its state stays in cache
+  for(int i = 0; i < n; i++) {
+    chipper *c = handles[i];
+    stepOne(c, keys ? keys[i] : 0, frames);
+    const chipState &s = c->cpu.getState();
+    if(screens)
+      memcpy(screens + (size_t)i * CHIPPER_SCREEN_BYTES, s.display, CHIPPER_SCREEN_BYTES);
+    if(memory)
+      memcpy(memory + (size_t)i * CHIPPER_MEMORY_BYTES, s.memory, CHIPPER_MEMORY_BYTES);
+    if(regs) {
+      chipper_regs &r = regs[i];
+      memcpy(r.V, s.V, 16);
+      r.I = s.mem_reg;
+      r.pc = s.pc;
+      r.sp = s.sp;
+      r.delay = s.delay;
+      r.sound = s.sound;
+      r.status = c->status;
+      r.frames = c->frames;
+    }
+    if(c->status == CHIPPER_RUNNING)
+      running++;
+  }
+  return running;
+}
+
+size_t chipper_state_size(void) {
+  return sizeof(chipState);
+}
+
+void chipper_save_state(chipper *c, void *out) {
+  memcpy(out, &c->cpu.getState(), sizeof(chipState));
+  return;
+}
+
+void chipper_load_state(chipper *c, const void *in) {
+  //the caller's buffer may not be aligned
+  chipState s;
+  memcpy(&s, in, sizeof(s));
+  c->cpu.setState(s);
+  c->status = CHIPPER_RUNNING;
+  return;
+}
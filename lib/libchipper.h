@@ -0,0 +1,80 @@
+#ifndef _LIBCHIPPER_
+#define _LIBCHIPPER_
+#include <stdint.h>
+#include <stddef.h>
+
+/*C interface to the chipper core, built as bin/libchipper.so with
+  make lib. No SDL, no window, no files: ROMs come in as bytes and
+  everything the game shows or holds goes out into arrays the caller
+  owns. Nothing here allocates after chipper_create.
+
+  Layouts and values in this file only ever grow. Check
+  chipper_abi_version() against CHIPPER_ABI_VERSION when loading the
+  library at runtime.*/
+
+#define CHIPPER_API __attribute__((visibility("default")))
+
+#define CHIPPER_ABI_VERSION 1
+#define CHIPPER_WIDTH 64
+#define CHIPPER_HEIGHT 32
+/*packed screen: 8 pixels per byte, rows top to bottom, MSB is leftmost*/
+#define CHIPPER_SCREEN_BYTES (CHIPPER_WIDTH * CHIPPER_HEIGHT / 8)
+#define CHIPPER_MEMORY_BYTES 4096
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct chipper chipper;
+
+enum chipper_status {
+  CHIPPER_RUNNING = 0,
+  CHIPPER_EXITED = 1, /*ran opcode 0000*/
+  CHIPPER_FAULT = 2 /*pc or I went out of memory*/
+};
+
+typedef struct chipper_regs {
+  uint8_t V[16];
+  uint16_t I;
+  uint16_t pc;
+  uint8_t sp;
+  uint8_t delay;
+  uint8_t sound;
+  uint8_t status; /*chipper_status. Stopped instances are skipped by step*/
+  uint32_t frames; /*frames stepped since the ROM was loaded or reset*/
+} chipper_regs;
+
+CHIPPER_API int chipper_abi_version(void);
+
+/*seed drives CXNN, the same seed and keys give the same game*/
+CHIPPER_API chipper *chipper_create(uint32_t seed);
+CHIPPER_API void chipper_destroy(chipper *);
+
+/*up to 0xE00 bytes, loaded at 0x200. Returns 0, or -1 if too big*/
+CHIPPER_API int chipper_load_rom(chipper *, const uint8_t *rom, size_t size);
+/*back to the state right after chipper_load_rom*/
+CHIPPER_API void chipper_reset(chipper *);
+/*opcodes per second, run at 60 frames per second. Default 800*/
+CHIPPER_API void chipper_set_speed(chipper *, int opsPerSec);
+
+/*Advance n instances by frames 60Hz frames each. keys[i] is the key
+  bitmask (bit k = key k held) for handles[i], held for every frame
+  of the call. After stepping, instance i writes:
+    screens + i * CHIPPER_SCREEN_BYTES   packed screen
+    regs[i]                              registers and status
+    memory + i * CHIPPER_MEMORY_BYTES    all of memory
+  Any of screens, regs and memory may be NULL. keys may be NULL for no
+  keys. Returns how many of the n instances are still running.*/
+CHIPPER_API int chipper_step_frames(chipper **handles, int n, const uint16_t *keys, int frames,
+                                    uint8_t *screens, chipper_regs *regs, uint8_t *memory);
+
+/*whole machine snapshots, chipper_state_size() bytes each*/
+CHIPPER_API size_t chipper_state_size(void);
+CHIPPER_API void chipper_save_state(chipper *, void *out);
+CHIPPER_API void chipper_load_state(chipper *, const void *in);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
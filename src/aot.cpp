@@ -0,0 +1,24 @@
+#include "aot.h"
+#include <cstring>
+#include <vector>
+
+//function static so registrations from other files' static
+//initializers never see it unconstructed
+static std::vector<const aotProgram *> &registry() {
+  static std::vector<const aotProgram *> programs;
+  return programs;
+}
+
+void aotRegister(const aotProgram *program) {
+  registry().push_back(program);
+  return;
+}
+
+const aotProgram *aotFind(const uint8_t *rom, size_t romSize) {
+  std::vector<const aotProgram *> &programs = registry();
+  for(size_t i = 0; i < programs.size(); i++) {
+    if(programs[i]->romSize == romSize && memcmp(programs[i]->rom, rom, romSize) == 0)
+      return programs[i];
+  }
+  return NULL;
+}
@@ -0,0 +1,39 @@
+#ifndef _AOT_
+#define _AOT_
+#include <cstdint>
+#include <cstddef>
+#include "chipstate.h"
+
+//Runtime side of chipper-aot. A ROM run through chipper-aot becomes a
+//C++ file with one switch label per basic block. Linking that file in
+//registers the program, and Chip8::loadROM attaches it when the loaded
+//ROM matches byte for byte. Anything the compiled code doesn't handle
+//(drawing, memory stores, BNNN targets, bad opcodes, self-modified code)
+//hands the pc back to the interpreter.
+
+//64 byte lines. Chip8 marks a line when an opcode stores into it, and
+//compiled blocks on a marked line are never run again.
+#define AOT_LINE_SHIFT 6
+#define AOT_LINES (4096 >> AOT_LINE_SHIFT)
+
+struct aotProgram {
+  const char *name;
+  const uint8_t *rom;
+  size_t romSize;
+  //runs whole blocks until the next one would go over budget or needs
+  //the interpreter. dirty is the AOT_LINES marks. Returns the number of
+  //opcodes executed.
+  int (*run)(chipState &, const uint8_t *dirty, int budget);
+};
+
+void aotRegister(const aotProgram *);
+const aotProgram *aotFind(const uint8_t *rom, size_t romSize);
+
+//generated files hold one of these so linking them in is enough
+struct aotRegistration {
+  aotRegistration(const aotProgram *program) {
+    aotRegister(program);
+  }
+};
+
+#endif
@@ -1,32 +1,32 @@
 #include "chip8.h"
+#include "debugger.h"
 #include <iostream>
 #include <sstream>
 #include <cstdlib>
 #include <string>
+#include <cstring>
 extern bool DEBUG_MODE;
 extern bool FIND_MODE;
 
 Chip8::Chip8() {
   //clear everything to 0
-  for(int i = 0; i < 4096; i++)
-    memory[i] = 0;
-  for(int i = 0; i < 16; i++) {
-    V[i] = 0;
-    stack[i] = 0;
-    keys[i] = false;
-  }
-  mem_reg = 0;
-  delay = 0;
-  sound = 0;
-  sp = 0;
-  pc = 0;
+  memset(&state, 0, sizeof(state));
+  //xorshift must never be 0. Seeded from rand() so games still differ run to run
+  state.rng = ((uint32_t)std::rand() << 1) | 1;
   opcode = 0;
   opCount = 0;
   customControls = false;
-  customColors = true;
-  for(int i = 0; i < PIX_COUNT; i++) {
-    board[i] = 0;
-  }
+  customColors = false;
+  native = NULL;
+  nativeOn = true;
+  debugger = NULL;
+  for(int i = 0; i < AOT_LINES; i++)
+    codeDirty[i] = 0;
+  //without custom colors everything draws in the default color
+  for(int i = 0; i < PIX_COUNT; i++)
+    pixelColor[i] = 1;
+  palette.push_back(0x000000);
+  palette.push_back(0x00FF00);
   if(DEBUG_MODE) {
     std::cout << "Creating log file\n";
     log.open("log.txt",std::ios::trunc);
@@ -56,7 +56,8 @@ Chip8::Chip8() {
     0xf0,0x80,0xf0,0x80,0x80 //F
     };
   for(int i = 0; i < 80; i++)
-    memory[i] = (uint8_t)font[i];
+    state.memory[i] = (uint8_t)font[i];
+  rehash();
 };
 
 Chip8::~Chip8() {
@@ -104,24 +105,46 @@ int Chip8::loadROM(char* filename) {
   if(DEBUG_MODE)
     debug("Trying color file " + _colorfilename);
   colorFile.open(_colorfilename.c_str(),std::ios::in | std::ios::binary | std::ios::ate);
+  std::vector<uint8_t> clr;
   if(colorFile.good()) {
     if(DEBUG_MODE)
       debug("Custom colors found.\n");
-    customColors = true;
-
+    clr.resize((int)colorFile.tellg());
+    colorFile.seekg(0);
+    colorFile.read((char *)clr.data(), clr.size());
   } else {
     if(DEBUG_MODE)
       debug("No custom colors\n");
   }
+  colorFile.close();
+  setColors(clr.data(), clr.size() / 5);
+
+  std::vector<uint8_t> rom(fileSize);
+  gameROM.seekg(0);
+  gameROM.read((char *)rom.data(),fileSize);
+  gameROM.close();
+  if(loadROM(rom.data(), fileSize))
+    return -1;
+  std::cout << "ROM opened\n";
+  if(native)
+    std::cout << "Running precompiled " << native->name << "\n";
+
+  if(DEBUG_MODE)
+    debug("ROM opened and loaded sucsessfully.\n");
+  return 0;
+};
 
-  //read and save colors from clr file
+//colors in clr file layout, 5 bytes each: sprite address (high byte
+//first), then R, G, B. Fewer than two turns custom colors off.
+void Chip8::setColors(const uint8_t *clr, int numOfColors) {
+  colorsList.clear();
+  customColors = true;
   spriteColor tempColor;
   tempColor.location[0] = 0;
   tempColor.location[1] = 0;
   tempColor.r = 0;
   tempColor.g = 0;
   tempColor.b = 0;
-  int numOfColors = ((int)colorFile.tellg()) / 5;
   if(numOfColors < 2) {
     //first two colors should be a custom background and then default color
     customColors = false;
@@ -129,9 +152,8 @@ int Chip8::loadROM(char* filename) {
     debug("Custom Color mode aborted.\n");
   } else {
     debug(std::to_string(numOfColors) + " colors\n");
-    colorFile.seekg(0);
     for(int i = 0; i < numOfColors; i++) {
-      colorFile.read((char *)&tempColor,5);
+      memcpy(&tempColor, clr + i * 5, 5);
       tempColor.add = (*((uint8_t *)(tempColor.location)) << 8) + *((uint8_t *)(&(tempColor.location[1])));
       if(DEBUG_MODE) {
         debug("Color for ");
@@ -156,31 +178,49 @@ int Chip8::loadROM(char* filename) {
       colorsList.push_back(tempColor);
     }
   }
-  colorFile.close();
+  palette.clear();
+  if(customColors) {
+    for(it = colorsList.begin(); it != colorsList.end(); it++)
+      palette.push_back((it->r << 16) | (it->g << 8) | it->b);
+  } else {
+    palette.push_back(0x000000);
+    palette.push_back(0x00FF00);
+  }
   it = colorsList.begin();
+  //pixels already on keep a valid color
+  for(int i = 0; i < PIX_COUNT; i++)
+    pixelColor[i] = pixelColor[i] < palette.size() ? pixelColor[i] : 1;
+  return;
+}
 
-  gameROM.seekg(0);
-  gameROM.read((char *)&(memory[0x200]),fileSize);
-  gameROM.close();
-  pc = 0x200; //default starting area for Chip8 games
-  std::cout << "ROM opened\n";
+//ROM already in memory. No color file lookup, that goes by filename
+int Chip8::loadROM(const uint8_t *rom, int size) {
+  if(size < 0 || size > 0xE00) {
+    std::cout << "ROM too large.\n";
+    return -1;
+  }
+  if(size > 0)
+    memcpy(&(state.memory[0x200]), rom, size);
+  rehash();
+  state.pc = 0x200; //default starting area for Chip8 games
 
-  if(DEBUG_MODE)
-    debug("ROM opened and loaded sucsessfully.\n");
+  native = aotFind(&(state.memory[0x200]), size);
+  for(int i = 0; i < AOT_LINES; i++)
+    codeDirty[i] = 0;
   return 0;
-};
+}
 
 int Chip8::executeOp() {
   opCount++;
-  if(pc >= 4096) {
+  if(state.pc >= 4096) {
     std::cout << "PC is out of bounds\n";
     if(DEBUG_MODE)
       debug("PC is OOB. See CPU dump.\n");
     return chip_oob;
   }
-  opcode = memory[pc];
+  opcode = state.memory[state.pc];
   opcode <<=8;
-  opcode += memory[pc+1];
+  opcode += state.memory[state.pc+1];
 
 
   if(DEBUG_MODE) {
@@ -188,7 +228,7 @@ int Chip8::executeOp() {
     ss << std::dec << opCount;
     debug(ss.str() + ": ");
     ss.str("");
-    ss << "0x" << std::hex << pc;
+    ss << "0x" << std::hex << state.pc;
     debug("pc - " + ss.str() + ", ");
     ss.str("");
     ss << "0x" << std::hex << opcode;
@@ -204,13 +244,12 @@ int Chip8::executeOp() {
     case 0x0000:
       if(opcode == 0x00E0) {
         //0x00E0 - clear screen
-        for(int i = 0; i < PIX_COUNT; i++)
-          board[i] = false;
-        pc+=2;
+        chipClearDisplay(state);
+        state.pc+=2;
       } else if(opcode == 0x00EE) {
         //0x00EE - return from sub
-        sp--;
-        pc = stack[sp];
+        state.sp--;
+        state.pc = state.stack[state.sp];
       } else {
         //machine code possible here. NOP for now
         if (opcode == 0x0000) {
@@ -224,173 +263,181 @@ int Chip8::executeOp() {
           std::cout << "Bad opcode. NOP\n";
           if(DEBUG_MODE)
             debug("BAD OPCODE");
-          pc+=2;
+          state.pc+=2;
         }
       }
       break;
     case 0x1000:
       //1NNN - jump to NNN
-      pc = opcode & 0x0FFF;
+      state.pc = opcode & 0x0FFF;
       break;
     case 0x2000:
       //2NNN - call sub
-      pc+=2;
-      stack[sp] = pc;
-      sp++;
-      pc = opcode & 0x0FFF;
+      state.pc+=2;
+      state.stack[state.sp] = state.pc;
+      state.sp++;
+      state.pc = opcode & 0x0FFF;
       break;
     case 0x3000:
       //3XNN - skip next if VX == NN
-      pc = V[x_code] == (opcode & 0x00FF) ? pc+4 : pc+2;
+      state.pc = state.V[x_code] == (opcode & 0x00FF) ? state.pc+4 : state.pc+2;
       break;
     case 0x4000:
       //4XNN - skip next if VX != NN
-      pc = V[x_code] != (opcode & 0x00FF) ? pc+4 : pc+2;
+      state.pc = state.V[x_code] != (opcode & 0x00FF) ? state.pc+4 : state.pc+2;
       break;
     case 0x5000:
       //5XY0 - skip next if VX == VY
-      pc = V[x_code] == V[y_code] ? pc+4 : pc+2;
+      state.pc = state.V[x_code] == state.V[y_code] ? state.pc+4 : state.pc+2;
       break;
     case 0x6000:
       //6XNN - set VX to NN
-      V[x_code] = opcode & 0x00FF;
-      pc+=2;
+      state.V[x_code] = opcode & 0x00FF;
+      state.pc+=2;
       break;
     case 0x7000:
       //7XNN - add NN to VX
-      V[x_code] = (int8_t)(V[x_code] + opcode & 0x00FF);
-      pc+=2;
+      state.V[x_code] = (int8_t)(state.V[x_code] + opcode & 0x00FF);
+      state.pc+=2;
       break;
     case 0x8000:
       switch (opcode & 0x000F) {
         case 0:
           //8XY0 - Set VX = VY
-          V[x_code] = V[y_code];
+          state.V[x_code] = state.V[y_code];
           break;
         case 1:
           //8XY1 - Set VX = VX OR VY
-          V[x_code] = V[x_code] | V[y_code];
+          state.V[x_code] = state.V[x_code] | state.V[y_code];
           break;
         case 2:
           //8XY2 - Set VX = VX AND VY
-          V[x_code] = V[x_code] & V[y_code];
+          state.V[x_code] = state.V[x_code] & state.V[y_code];
           break;
         case 3:
           //8XY3 - Set VX = VX XOR VY
-          V[x_code] = V[x_code] ^ V[y_code];
+          state.V[x_code] = state.V[x_code] ^ state.V[y_code];
           break;
         case 4:
           //8XY4 - Set VX = VX + XY, set VF as cary
-          V[15] = V[x_code] + V[y_code] > 0xFF ? 1 : 0;
-          V[x_code]+=V[y_code];
+          state.V[15] = state.V[x_code] + state.V[y_code] > 0xFF ? 1 : 0;
+          state.V[x_code]+=state.V[y_code];
           break;
         case 5:
           //8XY5 - Set VX = VX - VY, set VF to 0 if borrow
-          V[15] = V[x_code] > V[y_code] ? 1: 0;
-          V[x_code] = (uint8_t)(V[x_code] - V[y_code]);
+          state.V[15] = state.V[x_code] > state.V[y_code] ? 1: 0;
+          state.V[x_code] = (uint8_t)(state.V[x_code] - state.V[y_code]);
           break;
         case 6:
           //8XY6 - Set VX = VY >> 1, store LSB of VY in VF
           //this op code seems to be contested
           //this was an undoc'd opcode in the original spec.
-          V[15] = V[x_code] & 0x01 == 1 ? 1 : 0;
-          V[x_code] = (V[x_code] >> 1);
+          state.V[15] = state.V[x_code] & 0x01 == 1 ? 1 : 0;
+          state.V[x_code] = (state.V[x_code] >> 1);
           break;
         case 7:
           //8XY7 - Set VX = VY - VX
-          V[15] = V[x_code] > V[y_code] ? 0 : 1;
-          V[x_code] = (uint8_t)(V[y_code] - V[x_code]);
+          state.V[15] = state.V[x_code] > state.V[y_code] ? 0 : 1;
+          state.V[x_code] = (uint8_t)(state.V[y_code] - state.V[x_code]);
           break;
         case 0xe:
           //8XYE - Set VX = VY << 1, store MSB of VY in VF
           //this is also a contested op code.
           //this was an undoc'd opcode in the original spec
-          V[15] = V[x_code] & 0x80 == 0x8000 ? 1 : 0;
-          V[x_code] = (V[x_code] << 1);
+          state.V[15] = state.V[x_code] & 0x80 == 0x8000 ? 1 : 0;
+          state.V[x_code] = (state.V[x_code] << 1);
           break;
       }
-      pc+=2;
+      state.pc+=2;
       break;
     case 0x9000:
       //9XY0 - Skip next instruction if VX != VY
-      pc += V[x_code] != V[y_code] ? 4 : 2;
+      state.pc += state.V[x_code] != state.V[y_code] ? 4 : 2;
       break;
     case 0xa000:
       //ANNN - Set I = NNN
-      mem_reg = opcode & 0x0FFF;
-      pc += 2;
+      state.mem_reg = opcode & 0x0FFF;
+      state.pc += 2;
       break;
     case 0xb000:
       //BNNN - Jump to V0 + NNN
-      pc = V[0] + (opcode & 0x0FFF);
+      state.pc = state.V[0] + (opcode & 0x0FFF);
       break;
     case 0xc000:
       //CXNN - Set VX = random number 0 to 255 masked with NN
-      V[x_code] = (std::rand() % 256) & (opcode & 0x00FF);
-      pc += 2;
+      state.V[x_code] = chipRandom(state) & (opcode & 0x00FF);
+      state.pc += 2;
       break;
     case 0xd000: {
       //DXYN - Draw N byte sprite in I at (VX,VY). If any pixels turned off, set VF = 1
-      int draw_color = 0x0000FF00;
+      int draw_color = 1; //palette index, 2nd color is the default
       if(customColors) {
         it = colorsList.begin();
         it++;
-        draw_color = (it->r << 16) | (it->g << 8) | (it->b); //2nd color default
         it++;
-        for (int i = 2; i < colorsList.size(); i++) {
-          if (it->add == mem_reg) {
-            draw_color = (it->r << 16) | (it->g << 8) | (it->b);
+        for (int i = 2; i < (int)colorsList.size(); i++) {
+          if (it->add == state.mem_reg) {
+            draw_color = i;
             break;
           }
           it++;
         }
       }
 
-      if(mem_reg + (opcode & 0x000F) >= 4096) {
+      if(state.mem_reg + (opcode & 0x000F) >= 4096) {
         std::cout << "Attempt to access out of bounds memory.";
         if(DEBUG_MODE)
           debug("BAD MEMORY\n");
         return chip_oob;
       } 
-      V[15] = 0;
+      state.V[15] = 0;
       if(FIND_MODE) //print the address of a sprite. useful for custom colors
-        std::cout << "Sprite at I 0x" << std::hex << mem_reg << " " << opcode << std::dec << "\n";
+        std::cout << "Sprite at I 0x" << std::hex << state.mem_reg << " " << opcode << std::dec << "\n";
+      //the display is packed 8 pixels a byte, so a sprite row lands on at
+      //most two bytes. The second one wraps around to the left edge.
+      int x_pos = state.V[x_code] % PIX_WIDTH;
+      int shift = x_pos % 8;
       for(int i = 0; i < (opcode & 0x000F); i++) {
-        for(int j = 0; j < 8; j++) {
-          int cur_pixel = ((V[y_code] + i) % PIX_HEIGHT) * PIX_WIDTH + (V[x_code] + j) % PIX_WIDTH;
-          if ((board[cur_pixel] != 0) && ((memory[mem_reg+i] & (0x80 >> j)) != 0))
-            V[15] = 1;
-          //this is a rather long way of writing a logical XOR
-          //seems like it should be doable in 1 line, but C++ aint havin it rn
-          if(board[cur_pixel]) {
-            if(memory[mem_reg+i] & (0x80 >> j))
-              board[cur_pixel] = 0;
-          } else {
-            if(memory[mem_reg+i] & (0x80 >> j)) {
-              board[cur_pixel] = draw_color;
+        uint8_t *row = &state.display[((state.V[y_code] + i) % PIX_HEIGHT) * (PIX_WIDTH / 8)];
+        uint8_t sprite = state.memory[state.mem_reg+i];
+        int byte[2] = {x_pos / 8, (x_pos / 8 + 1) % (PIX_WIDTH / 8)};
+        uint8_t bits[2] = {(uint8_t)(sprite >> shift), (uint8_t)(sprite << (8 - shift))};
+        for(int k = 0; k < 2; k++) {
+          if(row[byte[k]] & bits[k])
+            state.V[15] = 1;
+          if(customColors) {
+            //pixels turning on take the sprite's color
+            uint8_t turnedOn = bits[k] & ~row[byte[k]];
+            for(int j = 0; j < 8; j++) {
+              if(turnedOn & (0x80 >> j))
+                pixelColor[(row - state.display + byte[k]) * 8 + j] = draw_color;
             }
           }
+          if(bits[k])
+            chipDisplayXor(state, row - state.display + byte[k], bits[k]);
         }
       }
-      pc += 2;
+      state.pc += 2;
+      if(debugger && debugger->checkMemory(state.pc - 2, state.mem_reg, opcode & 0x000F, watch_read))
+        return chip_break;
       break;
     }
     case 0xE000:
       switch(opcode & 0x00FF) {
         case 0x9E:
           //EX9E - Skip next if key in Vx is pressed
-          pc += keys[(V[x_code] & 0x000F)] ? 4 : 2;
+          state.pc += (state.keys >> (state.V[x_code] & 0x000F)) & 1 ? 4 : 2;
           break; 
         case 0xA1:
           //EXA1 - Skip next if key in Vx is NOT pressed
-          pc += keys[(V[x_code] & 0x000F)] ? 2 : 4;
+          state.pc += (state.keys >> (state.V[x_code] & 0x000F)) & 1 ? 2 : 4;
           break;
         default:
           //bad code. NOP
           std::cout << "Bad opcode.\n";
           if(DEBUG_MODE)
             debug("BAD OPCODE");
-          pc+=2;
+          state.pc+=2;
           break;
       }
       break;
@@ -398,91 +445,102 @@ int Chip8::executeOp() {
       switch(opcode & 0x00FF) {
         case 0x07:
           //FX07 - Store delay timer in VX
-          V[x_code] = delay;
-          pc+=2;
+          state.V[x_code] = state.delay;
+          state.pc+=2;
           break;
         case 0x0A:
           //FX0A - Wait for keypress and store in Vx
           //this is more like a system interupt.
           //will not progress past this opcode until keypress
           for(int i = 0; i < 16; i++) {
-            if(keys[i]) {
-              V[x_code] = i;
-              pc+=2;
+            if((state.keys >> i) & 1) {
+              state.V[x_code] = i;
+              state.pc+=2;
               break;
             }
           }
           break;
         case 0x15:
           //FX15 - Set delay timer = VX
-          delay = V[x_code];
-          pc+=2;
+          state.delay = state.V[x_code];
+          state.pc+=2;
           break;
         case 0x18:
           //FX18 - Set sound timer = VX
-          sound = V[x_code];
-          pc+=2;
+          state.sound = state.V[x_code];
+          state.pc+=2;
           break;
         case 0x1E:
           //FX1E - Set I = I + VX
-          mem_reg += V[x_code];
-          pc+=2;
+          state.mem_reg += state.V[x_code];
+          state.pc+=2;
           break;
         case 0x29:
           //FX29 - Load font of number in VX into I
-          if(V[x_code] > 0xF) {
+          if(state.V[x_code] > 0xF) {
             std::cout << "Attempt to load bad font\n";
             if(DEBUG_MODE)
               debug("BAD FONT");
           }
-          mem_reg = V[x_code] * 5;
-          pc+=2;
+          state.mem_reg = state.V[x_code] * 5;
+          state.pc+=2;
           break;
         case 0x33:
           //FX33 - Load BCD of VX into I, I+1, I+2
-          if(mem_reg+2 >= 4096) {
+          if(state.mem_reg+2 >= 4096) {
             std::cout << "Attempt to access out of bounds memory.";
             if(DEBUG_MODE)
               debug("BAD MEMORY\n");
             return chip_oob;
           }
-          memory[mem_reg] = (V[x_code] / 100);
-          memory[mem_reg+1] = ((V[x_code] % 100) / 10);
-          memory[mem_reg+2] = ((V[x_code] % 100) % 10);
-          pc+=2;
+          chipStore(state, state.mem_reg, state.V[x_code] / 100);
+          chipStore(state, state.mem_reg+1, (state.V[x_code] % 100) / 10);
+          chipStore(state, state.mem_reg+2, (state.V[x_code] % 100) % 10);
+          //self modifying code check for precompiled blocks
+          codeDirty[state.mem_reg >> AOT_LINE_SHIFT] = 1;
+          codeDirty[(state.mem_reg+2) >> AOT_LINE_SHIFT] = 1;
+          state.pc+=2;
+          if(debugger && debugger->checkMemory(state.pc - 2, state.mem_reg, 3, watch_write))
+            return chip_break;
           break;
         case 0x55:
           //FX55 - Store V0 through VX at I to I+X
-          if(mem_reg+x_code >= 4096) {
+          if(state.mem_reg+x_code >= 4096) {
             std::cout << "Attempt to access out of bounds memory.";
             if(DEBUG_MODE)
               debug("BAD MEMORY\n");
             return chip_oob;  
           }
           for(int i = 0; i <= x_code; i++) {
-            memory[mem_reg+i] = V[i];
+            chipStore(state, state.mem_reg+i, state.V[i]);
           }
-          pc+=2;
+          codeDirty[state.mem_reg >> AOT_LINE_SHIFT] = 1;
+          codeDirty[(state.mem_reg+x_code) >> AOT_LINE_SHIFT] = 1;
+          state.pc+=2;
+          if(debugger && debugger->checkMemory(state.pc - 2, state.mem_reg, x_code + 1, watch_write))
+            return chip_break;
           break;
         case 0x65:
           //FX65 Load V0 to VX from I to I+X
-          if(mem_reg+x_code >= 4096) {
+          if(state.mem_reg+x_code >= 4096) {
             std::cout << "Attempt to access out of bounds memory.";
             if(DEBUG_MODE)
               debug("BAD MEMORY\n");
             return chip_oob;  
           }
           for(int i = 0; i <= x_code; i++) {
-            V[i] = memory[mem_reg+i];
+            state.V[i] = state.memory[state.mem_reg+i];
           }
-          pc+=2;
+          state.pc+=2;
+          if(debugger && debugger->checkMemory(state.pc - 2, state.mem_reg, x_code + 1, watch_read))
+            return chip_break;
           break;
         default:
           //Bad Opcode. NOP
           std::cout << "Bad Opode\n";
           if(DEBUG_MODE)
             debug("BAD OPCODE");
-          pc+=2;
+          state.pc+=2;
           break;
       }
       break;
@@ -494,24 +552,147 @@ int Chip8::executeOp() {
   return chip_normal;
 };
 
+//Run up to count opcodes. Precompiled blocks are used when this ROM has
+//them, the interpreter picks up everything else. Stops early on exit/oob.
+int Chip8::executeOps(int count) {
+  if(debugger && debugger->isActive())
+    return executeChecked(count);
+  int done = 0;
+  int status = chip_normal;
+  while(done < count) {
+    //the per-op log only comes from the interpreter
+    if(native && nativeOn && !DEBUG_MODE) {
+      int ran = native->run(state, codeDirty, count - done);
+      opCount += ran;
+      done += ran;
+      if(done >= count)
+        break;
+    }
+    status = executeOp();
+    done++;
+    if(status != chip_normal)
+      break;
+  }
+  return status;
+}
+
+//executeOps while the debugger has something set. Interpreter only, the
+//precompiled blocks would run straight past breakpoints.
+int Chip8::executeChecked(int count) {
+  int status = chip_normal;
+  for(int done = 0; done < count; done++) {
+    if(debugger->checkBreak(state))
+      return chip_break;
+    status = executeOp();
+    if(status != chip_normal)
+      break;
+  }
+  return status;
+}
+
+bool Chip8::hasNative() {
+  return native != NULL;
+}
+
+void Chip8::useNative(bool on) {
+  nativeOn = on;
+  return;
+}
+
+void Chip8::attachDebugger(Debugger *d) {
+  debugger = d;
+  return;
+}
+
 void Chip8::timerTick() {
-  if(delay > 0)
-    delay--;
-  if(sound > 0)
-    sound--;
+  if(state.delay > 0)
+    state.delay--;
+  if(state.sound > 0)
+    state.sound--;
   return;
 }
 
 int Chip8::getPixel(int pix) {
-  return board[pix];
+  return chipPixel(state, pix) ? palette[pixelColor[pix]] : 0;
 };
 
 void Chip8::setKeys(bool *newKeys) {
   //this function is stupid
   //the only reason it exists is to follow "encapsulation"
   //and good OOP standards.
+  state.keys = 0;
+  for(int i = 0; i < 16; i++)
+    state.keys |= newKeys[i] ? 1 << i : 0;
+  return;
+}
+
+void Chip8::setKeys(uint16_t mask) {
+  state.keys = mask;
+  return;
+}
+
+const chipState &Chip8::getState() {
+  return state;
+}
+
+void Chip8::setState(const chipState &from) {
+  memcpy(&state, &from, sizeof(state));
+  //precompiled blocks are only good where the code still matches the ROM
+  if(native) {
+    for(int i = 0; i < AOT_LINES; i++)
+      codeDirty[i] = 0;
+    for(size_t i = 0; i < native->romSize; i++) {
+      if(state.memory[0x200 + i] != native->rom[i])
+        codeDirty[(0x200 + i) >> AOT_LINE_SHIFT] = 1;
+    }
+  }
+  return;
+}
+
+uint64_t Chip8::getHash() {
+  return chipHash(state);
+}
+
+void Chip8::rehash() {
+  state.hash = chipHashBytes(state);
+  return;
+}
+
+uint64_t chipHashBytes(const chipState &s) {
+  uint64_t hash = 0;
+  for(int i = 0; i < 4096; i++)
+    hash ^= chipHashByte(i, s.memory[i]);
+  for(int i = 0; i < PIX_COUNT / 8; i++)
+    hash ^= chipHashByte(4096 + i, s.display[i]);
+  return hash;
+}
+
+chipState *newStates(size_t count) {
+  //over allocate, align, and keep the real pointer just in front
+  uint8_t *block = new uint8_t[count * sizeof(chipState) + 64 + sizeof(void *)];
+  uintptr_t start = (uintptr_t)(block + sizeof(void *));
+  start = (start + 63) & ~(uintptr_t)63;
+  ((uint8_t **)start)[-1] = block;
+  chipState *states = (chipState *)start;
+  memset(states, 0, count * sizeof(chipState));
+  return states;
+}
+
+void deleteStates(chipState *states) {
+  if(states)
+    delete[] ((uint8_t **)states)[-1];
+  return;
+}
+
+void Chip8::getRegs(chipRegs &regs) {
   for(int i = 0; i < 16; i++)
-    keys[i] = newKeys[i];
+    regs.V[i] = state.V[i];
+  regs.mem_reg = state.mem_reg;
+  regs.pc = state.pc;
+  regs.sp = state.sp;
+  regs.delay = state.delay;
+  regs.sound = state.sound;
+  regs.pad = 0;
   return;
 }
 
@@ -520,23 +701,23 @@ void Chip8::dumpCpu() {
   debug("\n\nFinal CPU dump:\n");
   for(int i = 0; i < 16; i ++) {
     ss.str("");
-    ss << "V" << std::hex << i  << std::dec << ": 0x" << std::hex << (int)V[i] << std::dec<< std::endl;
+    ss << "V" << std::hex << i  << std::dec << ": 0x" << std::hex << (int)state.V[i] << std::dec<< std::endl;
     debug(ss.str());
   }
   ss.str("");
-  ss << "PC: 0x" << std::hex << (int)pc << std::dec << "\n";
+  ss << "PC: 0x" << std::hex << (int)state.pc << std::dec << "\n";
   debug(ss.str());
   ss.str("");
-  ss << "I: 0x" << std::hex << (int)mem_reg << std::dec << "\n";
+  ss << "I: 0x" << std::hex << (int)state.mem_reg << std::dec << "\n";
   debug(ss.str());
   ss.str("");
-  ss << "SP: 0x" << std::hex << (int)sp << std::dec << "\n";
+  ss << "SP: 0x" << std::hex << (int)state.sp << std::dec << "\n";
   debug(ss.str());
   ss.str("");
-  ss << "Delay Timer: 0x" << std::hex << (int)delay << std::dec << "\n";
+  ss << "Delay Timer: 0x" << std::hex << (int)state.delay << std::dec << "\n";
   debug(ss.str());
   ss.str("");
-  ss << "Sound Timer: 0x" << std::hex << (int)sound << std::dec << "\n";
+  ss << "Sound Timer: 0x" << std::hex << (int)state.sound << std::dec << "\n";
   debug(ss.str());
   ss.str("");
   debug("\n\nSprite Dump\n");
@@ -553,7 +734,7 @@ void Chip8::dumpCpu() {
     ss.str("");
     ss << "0x" << std::hex << i << " ";
     for(int j = 0; j < 8; j++)
-      ss << (int)memory[i+j] << " ";
+      ss << (int)state.memory[i+j] << " ";
     ss << "\n";
     debug(ss.str());
   }
@@ -573,6 +754,16 @@ void Chip8::getBackgroundRGB(int rgb[3]) {
   return;
 };
 
+//every color the game can draw with as 0xRRGGBB. Background first, then
+//the default draw color, then the sprite colors from the clr file.
+//Returns how many were written.
+int Chip8::getPalette(uint32_t *rgb, int max) {
+  int count = 0;
+  for(size_t i = 0; i < palette.size() && count < max; i++)
+    rgb[count++] = palette[i];
+  return count;
+}
+
 void Chip8::debug(std::string dbString) {
   log << dbString;
   return;
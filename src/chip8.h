@@ -3,9 +3,11 @@
 #include <cstdint>
 #include <fstream>
 #include <list>
-#define PIX_WIDTH 64
-#define PIX_HEIGHT 32
-#define PIX_COUNT 64*32
+#include <vector>
+#include "chipstate.h"
+#include "aot.h"
+
+class Debugger;
 
 struct spriteColor {
   char location[2];
@@ -15,10 +17,22 @@ struct spriteColor {
   uint16_t add;
 };
 
+//copy of the registers for anything outside the core
+struct chipRegs {
+  uint8_t V[16];
+  uint16_t mem_reg;
+  uint16_t pc;
+  uint8_t sp;
+  uint8_t delay;
+  uint8_t sound;
+  uint8_t pad;
+};
+
 enum returnCodes {
   chip_normal,
   chip_exit,
-  chip_oob
+  chip_oob,
+  chip_break //stopped by the attached Debugger
 };
 
 class Chip8 {
@@ -26,32 +40,44 @@ class Chip8 {
     ~Chip8();
     Chip8();
     int loadROM(char* filename);
+    int loadROM(const uint8_t *rom, int size);
     int executeOp();
+    int executeOps(int count);
+    bool hasNative();
+    void useNative(bool);
+    void attachDebugger(Debugger *);
     void timerTick();
     int getPixel(int);
     void setKeys(bool *);
+    void setKeys(uint16_t mask); //bit n is key n
+    void getRegs(chipRegs &);
+    const chipState &getState();
+    void setState(const chipState &); //clone another machine
+    uint64_t getHash(); //whole machine, cheap enough to check every opcode
+    void rehash(); //after writing memory or display behind the core's back
     void dumpCpu();
+    void setColors(const uint8_t *clr, int count);
     bool areCustomColors();
     void getBackgroundRGB(int rgb[3]);
+    int getPalette(uint32_t *rgb, int max);
     void debug(std::string);
     void debug(int);
   private:
-    uint8_t memory[4096]; //4kb of memory
-    uint8_t V[16]; //16 8 bit registers
-    uint16_t mem_reg; //known as "I" in Chip8 terms. Renamed since i is common for loops
-    uint8_t delay; // delay timer
-    uint8_t sound; //sound timer
-    uint8_t sp; //stack pointer
-    uint16_t pc; //program counter
-    uint16_t stack[16]; //stack
+    chipState state;
+    //frontend side, not part of the machine
     uint16_t opcode;
-    bool keys[16];
-    int board[PIX_COUNT];
     int opCount;
+    uint8_t pixelColor[PIX_COUNT]; //palette index of each lit pixel
+    std::vector<uint32_t> palette;
     bool customControls;
     bool customColors;
     std::list<spriteColor> colorsList;
     std::list<spriteColor>::iterator it;
+    const aotProgram *native; //precompiled blocks for this ROM, if linked in
+    bool nativeOn;
+    uint8_t codeDirty[AOT_LINES];
+    Debugger *debugger;
+    int executeChecked(int count);
 
     std::ofstream log;
 };
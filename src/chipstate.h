@@ -0,0 +1,97 @@
+#ifndef _CHIP_STATE_
+#define _CHIP_STATE_
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include <cstring>
+#define PIX_WIDTH 64
+#define PIX_HEIGHT 32
+#define PIX_COUNT 64*32
+
+//Everything a running chip8 program can see, and nothing else. Plain
+//data: copy a machine with one memcpy, keep thousands of them in one
+//block (newStates), or put one in shared memory. Colors, logging and
+//the window all live outside of it.
+struct alignas(64) chipState {
+  uint8_t memory[4096]; //4kb of memory
+  uint8_t display[PIX_COUNT / 8]; //1 bit per pixel, MSB is leftmost
+  uint8_t V[16]; //16 8 bit registers
+  uint16_t stack[16]; //stack
+  uint16_t mem_reg; //known as "I" in Chip8 terms. Renamed since i is common for loops
+  uint16_t pc; //program counter
+  uint8_t sp; //stack pointer
+  uint8_t delay; // delay timer
+  uint8_t sound; //sound timer
+  uint8_t pad[3];
+  uint16_t keys; //bit n set while key n is held
+  uint32_t rng; //CXNN random numbers, part of the state so copies stay in step
+  //running hash of memory and display, kept up to date by every store.
+  //chipHash adds the registers on top
+  uint64_t hash;
+};
+
+static_assert(std::is_standard_layout<chipState>::value, "chipState must stay plain data");
+static_assert(std::is_trivially_copyable<chipState>::value, "chipState must copy with memcpy");
+static_assert(offsetof(chipState, hash) - offsetof(chipState, V) == 64, "registers must be one padding free 64 byte block");
+
+//xorshift32, top byte is the random number
+inline uint8_t chipRandom(chipState &s) {
+  s.rng ^= s.rng << 13;
+  s.rng ^= s.rng >> 17;
+  s.rng ^= s.rng << 5;
+  return s.rng >> 24;
+}
+
+inline bool chipPixel(const chipState &s, int pix) {
+  return (s.display[pix >> 3] >> (7 - (pix & 7))) & 1;
+}
+
+//State hashing. Every byte of memory (index 0-4095) and display (4096
+//and up) adds chipHashByte(index, value) to state.hash with XOR, so a
+//store only has to take the old byte out and put the new one in. Zero
+//bytes add nothing, a cleared machine hashes to 0.
+inline uint64_t chipMix(uint64_t z) {
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+inline uint64_t chipHashByte(int index, uint8_t value) {
+  return value ? chipMix(((uint64_t)index << 8) | value) : 0;
+}
+
+inline void chipStore(chipState &s, int addr, uint8_t value) {
+  s.hash ^= chipHashByte(addr, s.memory[addr]) ^ chipHashByte(addr, value);
+  s.memory[addr] = value;
+}
+
+inline void chipDisplayXor(chipState &s, int byte, uint8_t bits) {
+  uint8_t before = s.display[byte];
+  s.display[byte] = before ^ bits;
+  s.hash ^= chipHashByte(4096 + byte, before) ^ chipHashByte(4096 + byte, s.display[byte]);
+}
+
+inline void chipClearDisplay(chipState &s) {
+  for(int i = 0; i < PIX_COUNT / 8; i++)
+    s.hash ^= chipHashByte(4096 + i, s.display[i]);
+  memset(s.display, 0, sizeof(s.display));
+}
+
+//state.hash worked out from scratch, for after bulk changes
+uint64_t chipHashBytes(const chipState &);
+
+//the whole machine: memory and display from state.hash plus every register
+inline uint64_t chipHash(const chipState &s) {
+  uint64_t words[8];
+  memcpy(words, s.V, sizeof(words));
+  uint64_t h = s.hash;
+  for(int i = 0; i < 8; i++)
+    h = (h ^ words[i]) * 0x100000001b3ULL;
+  return chipMix(h);
+}
+
+//count states in one 64 byte aligned block
+chipState *newStates(size_t count);
+void deleteStates(chipState *);
+
+#endif
@@ -0,0 +1,370 @@
+#include "debugger.h"
+#include "chip8.h"
+#include "disasm.h"
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+
+static bool getBit(const uint8_t *bits, int addr) {
+  return (bits[addr >> 3] >> (addr & 7)) & 1;
+}
+
+static void setBit(uint8_t *bits, int addr, bool on) {
+  if(on)
+    bits[addr >> 3] |= 1 << (addr & 7);
+  else
+    bits[addr >> 3] &= ~(1 << (addr & 7));
+  return;
+}
+
+//every number typed at the prompt is hex, 0x is optional
+static bool readHex(std::istringstream &in, int &value) {
+  std::string word;
+  if(!(in >> word))
+    return false;
+  char *end;
+  long parsed = strtol(word.c_str(), &end, 16);
+  if(*end != '\0' || parsed < 0 || parsed > 0xFFFF)
+    return false;
+  value = parsed;
+  return true;
+}
+
+//"V3", "vf" or "I"
+static int readReg(const std::string &word) {
+  if(word.size() == 1 && tolower(word[0]) == 'i')
+    return 16;
+  if(word.size() == 2 && tolower(word[0]) == 'v' && isxdigit(word[1]))
+    return strtol(word.c_str() + 1, NULL, 16);
+  return -1;
+}
+
+static const char *condNames[] = {"==", "!=", "<", "<=", ">", ">="};
+
+static bool testCond(const breakCond &c, const chipState &s) {
+  int value = c.reg == 16 ? s.mem_reg : s.V[c.reg];
+  switch(c.cmp) {
+    case cond_eq:
+      return value == c.value;
+    case cond_ne:
+      return value != c.value;
+    case cond_lt:
+      return value < c.value;
+    case cond_le:
+      return value <= c.value;
+    case cond_gt:
+      return value > c.value;
+    default:
+      return value >= c.value;
+  }
+}
+
+Debugger::Debugger() {
+  memset(breakBits, 0, sizeof(breakBits));
+  memset(watchBits, 0, sizeof(watchBits));
+  breakCount = 0;
+  watchCount = 0;
+  breakNow = false;
+  skipArmed = false;
+  skipPc = 0;
+}
+
+void Debugger::setBreak(uint16_t addr, bool on) {
+  addr &= 0xFFF;
+  if(getBit(breakBits, addr) != on)
+    breakCount += on ? 1 : -1;
+  setBit(breakBits, addr, on);
+  return;
+}
+
+bool Debugger::isBreak(uint16_t addr) {
+  return getBit(breakBits, addr & 0xFFF);
+}
+
+void Debugger::setWatch(uint16_t addr, int len, int types, bool on) {
+  for(int i = 0; i < len && addr + i < 4096; i++) {
+    for(int t = 0; t < 2; t++) {
+      if(!(types & (t ? watch_write : watch_read)))
+        continue;
+      if(getBit(watchBits[t], addr + i) != on)
+        watchCount += on ? 1 : -1;
+      setBit(watchBits[t], addr + i, on);
+    }
+  }
+  return;
+}
+
+bool Debugger::isWatch(uint16_t addr, int type) {
+  return getBit(watchBits[type == watch_write], addr & 0xFFF);
+}
+
+void Debugger::addCond(int reg, int cmp, uint16_t value) {
+  breakCond c;
+  c.reg = reg;
+  c.cmp = cmp;
+  c.value = value;
+  c.last = false;
+  conds.push_back(c);
+  return;
+}
+
+void Debugger::clearConds() {
+  conds.clear();
+  return;
+}
+
+void Debugger::requestBreak() {
+  breakNow = true;
+  return;
+}
+
+bool Debugger::isActive() {
+  return breakNow || breakCount > 0 || watchCount > 0 || !conds.empty();
+}
+
+bool Debugger::checkBreak(const chipState &s) {
+  bool skip = skipArmed && s.pc == skipPc;
+  skipArmed = false;
+  bool hit = false;
+  if(breakNow) {
+    breakNow = false;
+    reason = "Break";
+    hit = true;
+  }
+  if(!skip && breakCount > 0 && s.pc < 4096 && getBit(breakBits, s.pc)) {
+    std::stringstream ss;
+    ss << "Breakpoint at 0x" << std::hex << s.pc;
+    reason = ss.str();
+    hit = true;
+  }
+  //every condition is evaluated so last stays current
+  for(size_t i = 0; i < conds.size(); i++) {
+    bool now = testCond(conds[i], s);
+    if(now && !conds[i].last) {
+      std::stringstream ss;
+      ss << "Condition " << (conds[i].reg == 16 ? "I" : "V") << std::hex;
+      if(conds[i].reg < 16)
+        ss << conds[i].reg;
+      ss << " " << condNames[conds[i].cmp] << " 0x" << conds[i].value;
+      reason = ss.str();
+      hit = true;
+    }
+    conds[i].last = now;
+  }
+  return hit;
+}
+
+bool Debugger::checkMemory(uint16_t pc, uint16_t addr, int len, int type) {
+  if(watchCount == 0)
+    return false;
+  const uint8_t *bits = watchBits[type == watch_write];
+  for(int i = 0; i < len && addr + i < 4096; i++) {
+    if(getBit(bits, addr + i)) {
+      std::stringstream ss;
+      ss << (type == watch_write ? "Write" : "Read") << " of 0x" << std::hex << addr + i
+         << " by 0x" << pc;
+      reason = ss.str();
+      return true;
+    }
+  }
+  return false;
+}
+
+void Debugger::printRegs(const chipState &s) {
+  std::cout << std::hex << std::setfill('0');
+  std::cout << "PC 0x" << std::setw(3) << s.pc << "  I 0x" << std::setw(3) << s.mem_reg
+            << "  SP " << (int)s.sp << "  DT " << std::setw(2) << (int)s.delay
+            << "  ST " << std::setw(2) << (int)s.sound << "  keys " << std::setw(4) << s.keys << "\n";
+  for(int i = 0; i < 16; i++)
+    std::cout << "V" << i << " " << std::setw(2) << (int)s.V[i] << (i % 8 == 7 ? "\n" : "  ");
+  for(int i = 0; i < s.sp && i < 16; i++)
+    std::cout << (i ? " " : "stack ") << std::setw(3) << s.stack[i] << (i + 1 == s.sp ? "\n" : "");
+  std::cout << std::dec << std::setfill(' ');
+  return;
+}
+
+//count opcodes from addr. > marks the pc, * a breakpoint
+void Debugger::printList(const chipState &s, uint16_t addr, int count) {
+  std::cout << std::hex << std::setfill('0');
+  for(int i = 0; i < count && addr + 1 < 4096; i++, addr += 2) {
+    uint16_t op = (s.memory[addr] << 8) | s.memory[addr + 1];
+    std::cout << (addr == s.pc ? ">" : " ") << (isBreak(addr) ? "*" : " ")
+              << " 0x" << std::setw(3) << addr << "  " << std::setw(4) << op
+              << "  " << disassemble(op) << "\n";
+  }
+  std::cout << std::dec << std::setfill(' ');
+  return;
+}
+
+void Debugger::printInfo() {
+  std::cout << std::hex;
+  std::cout << "breakpoints:";
+  for(int a = 0; a < 4096; a++) {
+    if(getBit(breakBits, a))
+      std::cout << " 0x" << a;
+  }
+  std::cout << "\n";
+  for(int t = 0; t < 2; t++) {
+    std::cout << (t ? "write" : "read") << " watches:";
+    for(int a = 0; a < 4096; a++) {
+      if(!getBit(watchBits[t], a))
+        continue;
+      int end = a;
+      while(end + 1 < 4096 && getBit(watchBits[t], end + 1))
+        end++;
+      std::cout << " 0x" << a;
+      if(end > a)
+        std::cout << "-0x" << end;
+      a = end;
+    }
+    std::cout << "\n";
+  }
+  std::cout << "conditions:";
+  for(size_t i = 0; i < conds.size(); i++) {
+    std::cout << " ";
+    if(conds[i].reg == 16)
+      std::cout << "I";
+    else
+      std::cout << "V" << conds[i].reg;
+    std::cout << condNames[conds[i].cmp] << "0x" << conds[i].value;
+  }
+  std::cout << std::dec << "\n";
+  return;
+}
+
+static void printHelp() {
+  std::cout << "Numbers are hex.\n"
+            << "  b ADDR          toggle a breakpoint\n"
+            << "  r ADDR [LEN]    toggle a read watchpoint (DXYN, FX65)\n"
+            << "  w ADDR [LEN]    toggle a write watchpoint (FX33, FX55)\n"
+            << "  cond REG OP VAL break when V0-VF or I turns OP VAL (== != < <= > >=)\n"
+            << "  cond clear      remove all conditions\n"
+            << "  i               list breakpoints, watchpoints and conditions\n"
+            << "  s [N]           step N opcodes\n"
+            << "  c               continue\n"
+            << "  regs            registers and stack\n"
+            << "  x ADDR [LEN]    dump memory\n"
+            << "  l [ADDR] [N]    disassemble N opcodes, from the pc by default\n"
+            << "  q               quit chipper\n"
+            << "  h               this list\n";
+  return;
+}
+
+bool Debugger::prompt(Chip8 &cpu) {
+  const chipState &s = cpu.getState();
+  if(!reason.empty())
+    std::cout << reason << "\n";
+  reason.clear();
+  printList(s, s.pc, 1);
+  std::string line;
+  while(true) {
+    std::cout << "(chipper) " << std::flush;
+    if(!std::getline(std::cin, line)) {
+      //nobody left to type. Let the game run
+      std::cout << "\nNo input, debugger detached\n";
+      memset(breakBits, 0, sizeof(breakBits));
+      memset(watchBits, 0, sizeof(watchBits));
+      breakCount = 0;
+      watchCount = 0;
+      conds.clear();
+      return true;
+    }
+    std::istringstream in(line);
+    std::string cmd;
+    if(!(in >> cmd))
+      continue;
+    int addr, len;
+    if(cmd == "c") {
+      skipArmed = true;
+      skipPc = s.pc;
+      return true;
+    } else if(cmd == "q") {
+      return false;
+    } else if(cmd == "s") {
+      int steps = 1;
+      readHex(in, steps);
+      for(int i = 0; i < steps; i++) {
+        int status = cpu.executeOp();
+        if(status == chip_break) {
+          std::cout << reason << "\n";
+          reason.clear();
+          break;
+        }
+        if(status != chip_normal) {
+          std::cout << "Program stopped\n";
+          return false;
+        }
+      }
+      printList(s, s.pc, 1);
+    } else if(cmd == "b") {
+      if(!readHex(in, addr)) {
+        std::cout << "b ADDR\n";
+        continue;
+      }
+      setBreak(addr, !isBreak(addr));
+      std::cout << "Breakpoint at 0x" << std::hex << (addr & 0xFFF) << std::dec
+                << (isBreak(addr) ? " set\n" : " cleared\n");
+    } else if(cmd == "r" || cmd == "w") {
+      int type = cmd == "r" ? watch_read : watch_write;
+      len = 1;
+      if(!readHex(in, addr) || addr >= 4096) {
+        std::cout << cmd << " ADDR [LEN]\n";
+        continue;
+      }
+      readHex(in, len);
+      bool on = !isWatch(addr, type);
+      setWatch(addr, len, type, on);
+      std::cout << (type == watch_read ? "Read" : "Write") << " watch on 0x" << std::hex << addr
+                << " len 0x" << len << std::dec << (on ? " set\n" : " cleared\n");
+    } else if(cmd == "cond") {
+      std::string reg, op;
+      int value;
+      in >> reg;
+      if(reg == "clear") {
+        clearConds();
+        continue;
+      }
+      int r = readReg(reg);
+      int cmp = -1;
+      in >> op;
+      for(int i = 0; i < 6; i++) {
+        if(op == condNames[i])
+          cmp = i;
+      }
+      if(r < 0 || cmp < 0 || !readHex(in, value)) {
+        std::cout << "cond V0-VF|I == != < <= > >= VALUE\n";
+        continue;
+      }
+      addCond(r, cmp, value);
+    } else if(cmd == "i") {
+      printInfo();
+    } else if(cmd == "regs") {
+      printRegs(s);
+    } else if(cmd == "x") {
+      len = 0x40;
+      if(!readHex(in, addr) || addr >= 4096) {
+        std::cout << "x ADDR [LEN]\n";
+        continue;
+      }
+      readHex(in, len);
+      std::cout << std::hex << std::setfill('0');
+      for(int i = 0; i < len && addr + i < 4096; i++) {
+        if(i % 16 == 0)
+          std::cout << (i ? "\n" : "") << "0x" << std::setw(3) << addr + i << " ";
+        std::cout << " " << std::setw(2) << (int)s.memory[addr + i];
+      }
+      std::cout << std::dec << std::setfill(' ') << "\n";
+    } else if(cmd == "l") {
+      addr = s.pc;
+      len = 0x10;
+      readHex(in, addr);
+      readHex(in, len);
+      printList(s, addr, len);
+    } else {
+      printHelp();
+    }
+  }
+}
@@ -0,0 +1,73 @@
+#ifndef _DEBUGGER_
+#define _DEBUGGER_
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "chipstate.h"
+
+class Chip8;
+
+//Console debugger. Attach one to a Chip8 and executeOps stops with
+//chip_break on a breakpoint, watchpoint or register condition. Nothing
+//is checked while none are set, so an idle debugger costs nothing.
+//  pc breakpoints   one bit per address, tested before each opcode
+//  watchpoints      one bit per address, tested only by the opcodes that
+//                   touch memory through I (DXYN, FX33, FX55, FX65)
+//  conditions       VX or I compared to a value, break when one turns true
+
+enum watchTypes {
+  watch_read = 1,
+  watch_write = 2
+};
+
+enum condTypes {
+  cond_eq,
+  cond_ne,
+  cond_lt,
+  cond_le,
+  cond_gt,
+  cond_ge
+};
+
+struct breakCond {
+  int reg; //0-15 is VX, 16 is I
+  int cmp;
+  uint16_t value;
+  bool last; //only break when it turns true, not every opcode after
+};
+
+class Debugger {
+  public:
+    Debugger();
+    void setBreak(uint16_t addr, bool on);
+    bool isBreak(uint16_t addr);
+    void setWatch(uint16_t addr, int len, int types, bool on);
+    bool isWatch(uint16_t addr, int type);
+    void addCond(int reg, int cmp, uint16_t value);
+    void clearConds();
+    void requestBreak(); //stop before the next opcode
+    bool isActive(); //anything set that executeOps has to check for
+
+    //called from Chip8
+    bool checkBreak(const chipState &);
+    bool checkMemory(uint16_t pc, uint16_t addr, int len, int type);
+
+    //interactive prompt on stdin. Returns false when the user quits
+    bool prompt(Chip8 &);
+  private:
+    void printRegs(const chipState &);
+    void printList(const chipState &, uint16_t addr, int count);
+    void printInfo();
+    uint8_t breakBits[4096 / 8];
+    uint8_t watchBits[2][4096 / 8]; //reads, writes
+    int breakCount;
+    int watchCount;
+    std::vector<breakCond> conds;
+    bool breakNow;
+    //resuming from a breakpoint must not stop on it again straight away
+    bool skipArmed;
+    uint16_t skipPc;
+    std::string reason;
+};
+
+#endif
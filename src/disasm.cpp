@@ -0,0 +1,113 @@
+#include "disasm.h"
+#include <sstream>
+
+static std::string reg(int r) {
+  std::stringstream ss;
+  ss << "V" << std::uppercase << std::hex << r;
+  return ss.str();
+}
+
+static std::string hex(int value) {
+  std::stringstream ss;
+  ss << "0x" << std::uppercase << std::hex << value;
+  return ss.str();
+}
+
+std::string disassemble(uint16_t opcode) {
+  int x = (opcode & 0x0F00) >> 8;
+  int y = (opcode & 0x00F0) >> 4;
+  int n = opcode & 0x000F;
+  int nn = opcode & 0x00FF;
+  int nnn = opcode & 0x0FFF;
+  std::string vx = reg(x);
+  std::string vy = reg(y);
+
+  switch(opcode & 0xF000) {
+    case 0x0000:
+      if(opcode == 0x00E0)
+        return "CLS";
+      if(opcode == 0x00EE)
+        return "RET";
+      if(opcode == 0x0000)
+        return "EXIT";
+      return "SYS " + hex(nnn);
+    case 0x1000:
+      return "JP " + hex(nnn);
+    case 0x2000:
+      return "CALL " + hex(nnn);
+    case 0x3000:
+      return "SE " + vx + ", " + hex(nn);
+    case 0x4000:
+      return "SNE " + vx + ", " + hex(nn);
+    case 0x5000:
+      return "SE " + vx + ", " + vy;
+    case 0x6000:
+      return "LD " + vx + ", " + hex(nn);
+    case 0x7000:
+      return "ADD " + vx + ", " + hex(nn);
+    case 0x8000:
+      switch(n) {
+        case 0x0:
+          return "LD " + vx + ", " + vy;
+        case 0x1:
+          return "OR " + vx + ", " + vy;
+        case 0x2:
+          return "AND " + vx + ", " + vy;
+        case 0x3:
+          return "XOR " + vx + ", " + vy;
+        case 0x4:
+          return "ADD " + vx + ", " + vy;
+        case 0x5:
+          return "SUB " + vx + ", " + vy;
+        case 0x6:
+          return "SHR " + vx;
+        case 0x7:
+          return "SUBN " + vx + ", " + vy;
+        case 0xE:
+          return "SHL " + vx;
+      }
+      break;
+    case 0x9000:
+      return "SNE " + vx + ", " + vy;
+    case 0xA000:
+      return "LD I, " + hex(nnn);
+    case 0xB000:
+      return "JP V0, " + hex(nnn);
+    case 0xC000:
+      return "RND " + vx + ", " + hex(nn);
+    case 0xD000: {
+      std::stringstream ss;
+      ss << "DRW " << vx << ", " << vy << ", " << n;
+      return ss.str();
+    }
+    case 0xE000:
+      if(nn == 0x9E)
+        return "SKP " + vx;
+      if(nn == 0xA1)
+        return "SKNP " + vx;
+      break;
+    case 0xF000:
+      switch(nn) {
+        case 0x07:
+          return "LD " + vx + ", DT";
+        case 0x0A:
+          return "LD " + vx + ", K";
+        case 0x15:
+          return "LD DT, " + vx;
+        case 0x18:
+          return "LD ST, " + vx;
+        case 0x1E:
+          return "ADD I, " + vx;
+        case 0x29:
+          return "LD F, " + vx;
+        case 0x33:
+          return "LD B, " + vx;
+        case 0x55:
+          return "LD [I], " + vx;
+        case 0x65:
+          return "LD " + vx + ", [I]";
+      }
+      break;
+  }
+  return "DW " + hex(opcode);
+}
@@ -0,0 +1,10 @@
+#ifndef _DISASM_
+#define _DISASM_
+#include <cstdint>
+#include <string>
+
+//Turns one opcode into a readable instruction, Cowgod style
+//mnemonics. "LD V1, 0x05", "DRW V0, V1, 5" etc.
+std::string disassemble(uint16_t opcode);
+
+#endif
@@ -5,7 +5,15 @@
 #include <cstring>
 #include <cstdlib>
 #include <ctime>
+#include <cctype>
+#include <fstream>
+#include <vector>
 #include "chip8.h"
+#include "scaler.h"
+#include "shm.h"
+#include "recorder.h"
+#include "debugger.h"
+#include "romlib.h"
 
 bool DEBUG_MODE = false;
 bool FIND_MODE = false;
@@ -14,6 +22,11 @@ void printBoard(int *board); // prints an ASCII board to console for debugging
 
 int main(int argc, char **args) {
   std::cout << "Are we booting?\n";
+  Scaler scaler;
+  const char *shmName = NULL;
+  const char *recordPath = NULL;
+  bool useDebugger = false;
+  const char *indexPath = NULL;
 
   std::srand(std::time(NULL));
   if(argc == 1) {
@@ -31,10 +44,22 @@ int main(int argc, char **args) {
       }
       if(strcmp(args[i],"find") == 0)
         FIND_MODE = true;
+      if(strcmp(args[i],"debugger") == 0)
+        useDebugger = true;
+      if(strncmp(args[i],"scale=",6) == 0) {
+        if(!scaler.setModeByName(args[i] + 6))
+          std::cout << "Unknown scale mode " << args[i] + 6 << "\n";
+      }
+      if(strncmp(args[i],"shm=",4) == 0)
+        shmName = args[i] + 4;
+      if(strncmp(args[i],"record=",7) == 0)
+        recordPath = args[i] + 7;
+      if(strncmp(args[i],"index=",6) == 0)
+        indexPath = args[i] + 6;
     }
   }
 
-  //Chip8 has a 64x32 pixel board. Scale pixel size by WIN_SCALE
+  //Chip8 has a 64x32 pixel board. Window starts at WIN_SCALE, but can be resized
   int WIN_SCALE = 8;
 
   if(SDL_Init(SDL_INIT_VIDEO)) {
@@ -50,7 +75,36 @@ int main(int argc, char **args) {
     std::cout << "cpu initialized\n";
     std::cout << "Loading ROM: " << args[1] << "\n";
   }
-  if(cpu.loadROM(args[1])) {
+  //a ROM in the library index gets its settings from there, found by
+  //contents. Anything else goes through the colors folder as before
+  RomIndex romIndex;
+  const romEntry *romSettings = NULL;
+  std::vector<uint8_t> romData;
+  if(indexPath && romIndex.open(indexPath) == 0) {
+    std::ifstream romFile(args[1], std::ios::in | std::ios::binary | std::ios::ate);
+    long romSize = romFile.good() ? (long)romFile.tellg() : -1;
+    if(romSize >= 0) {
+      romData.resize(romSize);
+      romFile.seekg(0);
+      romFile.read((char *)romData.data(), romSize);
+      romSettings = romIndex.find(romData.data(), romData.size());
+    }
+    if(!romSettings)
+      std::cout << "ROM is not in " << indexPath << "\n";
+  }
+  if(romSettings) {
+    if(cpu.loadROM(romData.data(), romData.size())) {
+      std::cout << "Error opening ROM\n";
+      return -1;
+    }
+    const uint8_t *colors = romIndex.getColors(romSettings);
+    if(colors)
+      cpu.setColors(colors, romSettings->colorCount);
+    std::cout << "ROM opened as " << romIndex.getName(romSettings) << " from the index\n";
+    if(romSettings->quirks)
+      std::cout << "Index lists quirks 0x" << std::hex << romSettings->quirks << std::dec
+                << ", chipper doesn't emulate them yet\n";
+  } else if(cpu.loadROM(args[1])) {
     std::cout << "Error opening ROM\n";
     return -1;
   }
@@ -70,24 +124,78 @@ int main(int argc, char **args) {
     std::cout << "Background RGB: " << backgroundRGB[0] << ", " << backgroundRGB[1] << ", " << backgroundRGB[2] << "\n";
   }
 
-  //set up game window and pixel
-  SDL_Window* window = SDL_CreateWindow( "Chipper - Chip8 | OPS: 800", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 64*WIN_SCALE, 32*WIN_SCALE, SDL_WINDOW_SHOWN );
+  //the debugger prompt runs on the console. It opens before the first
+  //opcode so breakpoints can be set, and again whenever F1 is pressed
+  Debugger debugger;
+  if(useDebugger) {
+    cpu.attachDebugger(&debugger);
+    debugger.requestBreak();
+    std::cout << "Debugger attached. Press F1 in the game window to break\n";
+  }
+
+  //gameplay recording, written from its own thread
+  Recorder recorder;
+  if(recordPath) {
+    uint32_t palette[256];
+    int colors = cpu.getPalette(palette, 256);
+    if(recorder.open(recordPath, palette, colors) == 0)
+      std::cout << "Recording to " << recordPath << "\n";
+  }
+
+  //set up game window. The picture is scaled on the CPU into a streaming texture
+  SDL_Window* window = SDL_CreateWindow( "Chipper - Chip8 | OPS: 800", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 64*WIN_SCALE, 32*WIN_SCALE, SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE );
+  SDL_SetWindowMinimumSize(window, PIX_WIDTH, PIX_HEIGHT);
   SDL_Renderer* gameRenderer = SDL_CreateRenderer(window,-1,SDL_RENDERER_ACCELERATED);
-  SDL_SetRenderDrawColor(gameRenderer,backgroundRGB[0],backgroundRGB[1],backgroundRGB[2],255);
+  SDL_Texture* screen = NULL;
+  int screenW = 0;
+  int screenH = 0;
+  uint32_t background = 0xFF000000 | (backgroundRGB[0] << 16) | (backgroundRGB[1] << 8) | backgroundRGB[2];
+  uint32_t frame[PIX_COUNT];
+  uint32_t lastFrame[PIX_COUNT];
+  bool redraw = true;
   SDL_Event event;
   bool quit = false;
-  SDL_Rect *pixel = new SDL_Rect;
-  pixel->x = 0;
-  pixel->y = 0;
-  pixel->w = WIN_SCALE;
-  pixel->h = WIN_SCALE;
+  bool keyboard[16];
+  for(int i = 0; i < 16; i++)
+    keyboard[i] = false;
+  //this is a default mapping. The index can change it per ROM
+  SDL_Scancode keymap[16] = {
+    SDL_SCANCODE_X, SDL_SCANCODE_1, SDL_SCANCODE_2, SDL_SCANCODE_3,
+    SDL_SCANCODE_Q, SDL_SCANCODE_W, SDL_SCANCODE_E, SDL_SCANCODE_A,
+    SDL_SCANCODE_S, SDL_SCANCODE_D, SDL_SCANCODE_Z, SDL_SCANCODE_C,
+    SDL_SCANCODE_4, SDL_SCANCODE_R, SDL_SCANCODE_F, SDL_SCANCODE_V
+  };
+  for(int i = 0; romSettings && i < 16; i++) {
+    if(romSettings->keymap[i]) {
+      SDL_Scancode code = SDL_GetScancodeFromKey((SDL_Keycode)tolower(romSettings->keymap[i]));
+      if(code != SDL_SCANCODE_UNKNOWN)
+        keymap[i] = code;
+    }
+  }
+
+  //other programs can watch the screen and press keys through shared memory
+  ShmLink link;
+  uint64_t frameCount = 0;
+  if(shmName) {
+    if(link.create(shmName)) {
+      std::cout << "Shared memory disabled\n";
+    } else {
+      std::cout << "Sharing screen and keys as chipper-" << shmName << "\n";
+    }
+  }
   int opsPerSec = 800;
-  double msecPerOp = 1000.0 / 800;
+  if(romSettings && romSettings->opsPerSec) {
+    opsPerSec = romSettings->opsPerSec;
+    std::string title = "Chipper - Chip8 | OPS " + std::to_string(opsPerSec);
+    SDL_SetWindowTitle(window, title.c_str());
+  }
+  double opsOwed = 0; //instructions due but not run yet
   int delayTicks = 0;
   int delayDeltaTicks = 0;
   double sixtyHertz = 1000.0 / 60.0; //miliseonds
   int startCycleTicks = 0;
   int cycleDelta = 0;
+  int lastOpTicks = SDL_GetTicks();
 
   if(DEBUG_MODE) {
     std::cout << "Game window and renderer created successfully\n";
@@ -99,50 +207,39 @@ int main(int argc, char **args) {
     //timing of cycle
     startCycleTicks = SDL_GetTicks();
 
-    //clear screen
-    SDL_SetRenderDrawColor(gameRenderer,backgroundRGB[0],backgroundRGB[1],backgroundRGB[2],255);
-    SDL_RenderClear(gameRenderer);
-
     //input handling
     while(SDL_PollEvent(&event) != 0) {
       switch(event.type) {
         case SDL_QUIT:
           quit = true;
           break;
+        case SDL_WINDOWEVENT:
+          if(event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+            redraw = true;
+          break;
         case SDL_KEYDOWN:
         case SDL_KEYUP: {
           const uint8_t *keyState = SDL_GetKeyboardState(NULL);
-          bool keys[16];
-          //this is a default mapping. May want to change
-          keys[0] = keyState[SDL_SCANCODE_X];
-          keys[1] = keyState[SDL_SCANCODE_1];
-          keys[2] = keyState[SDL_SCANCODE_2];
-          keys[3] = keyState[SDL_SCANCODE_3];
-          keys[4] = keyState[SDL_SCANCODE_Q];
-          keys[5] = keyState[SDL_SCANCODE_W];
-          keys[6] = keyState[SDL_SCANCODE_E];
-          keys[7] = keyState[SDL_SCANCODE_A];
-          keys[8] = keyState[SDL_SCANCODE_S];
-          keys[9] = keyState[SDL_SCANCODE_D];
-          keys[10] = keyState[SDL_SCANCODE_Z];
-          keys[11] = keyState[SDL_SCANCODE_C];
-          keys[12] = keyState[SDL_SCANCODE_4];
-          keys[13] = keyState[SDL_SCANCODE_R];
-          keys[14] = keyState[SDL_SCANCODE_F];
-          keys[15] = keyState[SDL_SCANCODE_V];
-          cpu.setKeys(keys);
+          for(int i = 0; i < 16; i++)
+            keyboard[i] = keyState[keymap[i]];
+          cpu.setKeys(keyboard);
           if(keyState[SDL_SCANCODE_RIGHT]) {
             opsPerSec+=100;
-            msecPerOp = 1000.0 / opsPerSec;
             std::string title = "Chipper - Chip8 | OPS " + std::to_string(opsPerSec);
             SDL_SetWindowTitle(window, title.c_str());
           }
           if(keyState[SDL_SCANCODE_LEFT]) {
             opsPerSec-=100;
-            msecPerOp = 1000.0 / opsPerSec;
             std::string title = "Chipper - Chip8 | OPS " + std::to_string(opsPerSec);
             SDL_SetWindowTitle(window, title.c_str());
           }
+          if(event.type == SDL_KEYDOWN && !event.key.repeat && event.key.keysym.scancode == SDL_SCANCODE_TAB) {
+            scaler.setMode((scaler.getMode() + 1) % scale_modes);
+            std::cout << "Scale mode: " << Scaler::modeName(scaler.getMode()) << "\n";
+            redraw = true;
+          }
+          if(useDebugger && event.type == SDL_KEYDOWN && event.key.keysym.scancode == SDL_SCANCODE_F1)
+            debugger.requestBreak();
           break;
         }
         default:
@@ -150,13 +247,39 @@ int main(int argc, char **args) {
       }
     }
 
-    //execute next instruction
-    switch(cpu.executeOp()) {
+    //keys held through shared memory count as pressed too
+    if(link.isOpen()) {
+      uint32_t shmKeys = link.getKeys();
+      bool keys[16];
+      for(int i = 0; i < 16; i++)
+        keys[i] = keyboard[i] || ((shmKeys >> i) & 1);
+      cpu.setKeys(keys);
+    }
+
+    //execute the instructions that came due since the last pass.
+    //running them as a batch lets precompiled ROMs use whole blocks
+    opsOwed += (startCycleTicks - lastOpTicks) * opsPerSec / 1000.0;
+    lastOpTicks = startCycleTicks;
+    if(opsOwed > opsPerSec / 4.0) //don't race to catch up after a stall
+      opsOwed = opsPerSec / 4.0;
+    if(opsOwed < 0)
+      opsOwed = 0;
+    int opsDue = (int)opsOwed;
+    opsOwed -= opsDue;
+    switch(cpu.executeOps(opsDue)) {
       case chip_oob:
         if(DEBUG_MODE)
           cpu.debug("Stopped execution due to bad address. Check I\n");
       case chip_exit:
         quit = true;
+        break;
+      case chip_break:
+        //the window stops while the prompt waits on the console
+        if(!debugger.prompt(cpu))
+          quit = true;
+        lastOpTicks = SDL_GetTicks();
+        opsOwed = 0;
+        break;
       case chip_normal:
       default:
         break;
@@ -167,31 +290,58 @@ int main(int argc, char **args) {
     if( delayDeltaTicks - delayTicks > sixtyHertz) {
       cpu.timerTick();
       delayTicks = delayDeltaTicks;
+      frameCount++;
+      if(link.isOpen())
+        link.publish(cpu, frameCount, background);
+      if(recorder.isOpen()) {
+        uint32_t held = link.getKeys();
+        for(int i = 0; i < 16; i++)
+          held |= keyboard[i] ? 1 << i : 0;
+        recorder.addFrame(cpu, held);
+      }
     }
 
-    //draw active pixels
+    //build the 64x32 picture, only rescale when it or the window changed
     int cur_pix;
     for(int i = 0; i < PIX_COUNT; i++) {
       cur_pix = cpu.getPixel(i);
-      if(cur_pix) {
-        SDL_SetRenderDrawColor(gameRenderer,(cur_pix >> 16) & 0xFF, (cur_pix >> 8) & 0xFF, cur_pix & 0xFF,255);
-        pixel->x = (i % PIX_WIDTH) * WIN_SCALE;
-        pixel->y = (i / PIX_WIDTH) * WIN_SCALE;
-        SDL_RenderFillRect(gameRenderer,pixel);
+      frame[i] = cur_pix ? 0xFF000000 | cur_pix : background;
+    }
+    int outW, outH;
+    SDL_GetRendererOutputSize(gameRenderer, &outW, &outH);
+    if(screen == NULL || outW != screenW || outH != screenH) {
+      if(screen)
+        SDL_DestroyTexture(screen);
+      screen = SDL_CreateTexture(gameRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, outW, outH);
+      screenW = outW;
+      screenH = outH;
+      redraw = true;
+    }
+    if(redraw || memcmp(frame, lastFrame, sizeof(frame)) != 0) {
+      void *texPixels;
+      int pitch;
+      if(SDL_LockTexture(screen, NULL, &texPixels, &pitch) == 0) {
+        scaler.scale(frame, PIX_WIDTH, PIX_HEIGHT, (uint32_t *)texPixels, screenW, screenH, pitch, background);
+        SDL_UnlockTexture(screen);
       }
+      memcpy(lastFrame, frame, sizeof(frame));
+      redraw = false;
     }
 
     //display screen, wait
+    SDL_RenderCopy(gameRenderer, screen, NULL, NULL);
     SDL_RenderPresent(gameRenderer);
     cycleDelta = SDL_GetTicks() - startCycleTicks;
-    if (cycleDelta < msecPerOp)
-      SDL_Delay(msecPerOp - cycleDelta);
+    if (cycleDelta < 1)
+      SDL_Delay(1);
   }
 
   //dump CPU and cleanup
   if(DEBUG_MODE)
     cpu.dumpCpu();
-  delete pixel;
+  recorder.close();
+  if(screen)
+    SDL_DestroyTexture(screen);
   SDL_DestroyRenderer(gameRenderer);
   SDL_DestroyWindow(window);
   SDL_Quit();
@@ -0,0 +1,374 @@
+#include "recorder.h"
+#include <iostream>
+#include <cstring>
+#include <chrono>
+
+static void putVarint(std::vector<uint8_t> &buf, uint32_t value) {
+  while(value >= 0x80) {
+    buf.push_back((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  buf.push_back(value);
+  return;
+}
+
+//runs of (zeros, literal count, literals). Lone zeros between literals
+//stay in the literal run, a new run costs more than the zero does.
+static void putDelta(std::vector<uint8_t> &buf, const uint8_t *delta, int size) {
+  int pos = 0;
+  while(pos < size) {
+    int zeros = 0;
+    while(pos + zeros < size && delta[pos + zeros] == 0)
+      zeros++;
+    pos += zeros;
+    int start = pos;
+    while(pos < size) {
+      if(delta[pos] == 0 && (pos + 1 >= size || delta[pos + 1] == 0))
+        break;
+      pos++;
+    }
+    putVarint(buf, zeros);
+    putVarint(buf, pos - start);
+    buf.insert(buf.end(), delta + start, delta + pos);
+  }
+  return;
+}
+
+Recorder::Recorder() {
+  running = false;
+  queue = NULL;
+  head = 0;
+  tail = 0;
+  dropped = 0;
+  repeats = 0;
+  memset(&last, 0, sizeof(last));
+}
+
+Recorder::~Recorder() {
+  close();
+}
+
+int Recorder::open(const char *path, const uint32_t *colors, int colorCount) {
+  close();
+  out.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+  if(!out.good()) {
+    std::cout << "Error opening recording " << path << "\n";
+    return -1;
+  }
+  palette.assign(colors, colors + colorCount);
+  memset(&last, 0, sizeof(last));
+  repeats = 0;
+  dropped = 0;
+  head = 0;
+  tail = 0;
+  queue = new recFrame[REC_QUEUE];
+
+  std::vector<uint8_t> header;
+  header.push_back('C');
+  header.push_back('8');
+  header.push_back('R');
+  header.push_back('C');
+  header.push_back(REC_VERSION);
+  putVarint(header, PIX_WIDTH);
+  putVarint(header, PIX_HEIGHT);
+  putVarint(header, REC_FPS);
+  putVarint(header, colorCount);
+  for(int i = 0; i < colorCount; i++) {
+    header.push_back((colors[i] >> 16) & 0xFF);
+    header.push_back((colors[i] >> 8) & 0xFF);
+    header.push_back(colors[i] & 0xFF);
+  }
+  out.write((const char *)&header[0], header.size());
+
+  running = true;
+  worker = std::thread(&Recorder::writer, this);
+  return 0;
+}
+
+bool Recorder::isOpen() {
+  return queue != NULL;
+}
+
+int Recorder::getDropped() {
+  return dropped;
+}
+
+void Recorder::addFrame(Chip8 &cpu, uint16_t keys) {
+  if(!queue)
+    return;
+  uint32_t t = tail.load(std::memory_order_relaxed);
+  if(t - head.load(std::memory_order_acquire) >= REC_QUEUE) {
+    //the writer is way behind. Losing a frame beats stalling the game
+    dropped++;
+    return;
+  }
+  recFrame &f = queue[t % REC_QUEUE];
+  memcpy(f.bits, cpu.getState().display, sizeof(f.bits));
+  memset(f.colors, 0, sizeof(f.colors));
+  if(palette.size() > 2) {
+    uint32_t lastColor = 0;
+    uint8_t lastIndex = 0;
+    for(int i = 0; i < PIX_COUNT; i++) {
+      uint32_t pix = cpu.getPixel(i);
+      if(!pix)
+        continue;
+      if(pix != lastColor) {
+        lastColor = pix;
+        lastIndex = 0;
+        for(size_t c = 1; c < palette.size(); c++) {
+          if(palette[c] == lastColor) {
+            lastIndex = c - 1;
+            break;
+          }
+        }
+      }
+      f.colors[i] = lastIndex;
+    }
+  }
+  f.keys = keys;
+  tail.store(t + 1, std::memory_order_release);
+  wake.notify_one();
+  return;
+}
+
+void Recorder::writer() {
+  while(true) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if(h == tail.load(std::memory_order_acquire)) {
+      if(!running)
+        break;
+      //addFrame doesn't take the lock, so wake ups can be missed. The
+      //timeout covers that.
+      std::unique_lock<std::mutex> lock(waitLock);
+      wake.wait_for(lock, std::chrono::milliseconds(10));
+      continue;
+    }
+    encode(queue[h % REC_QUEUE]);
+    head.store(h + 1, std::memory_order_release);
+  }
+  return;
+}
+
+void Recorder::flushRepeats() {
+  if(repeats == 0)
+    return;
+  buffer.clear();
+  buffer.push_back(rec_repeat);
+  putVarint(buffer, repeats);
+  out.write((const char *)&buffer[0], buffer.size());
+  repeats = 0;
+  return;
+}
+
+void Recorder::encode(const recFrame &f) {
+  uint8_t bitDelta[PIX_COUNT / 8];
+  uint8_t colorDelta[PIX_COUNT];
+  int flags = 0;
+  for(int i = 0; i < PIX_COUNT / 8; i++) {
+    bitDelta[i] = f.bits[i] ^ last.bits[i];
+    if(bitDelta[i])
+      flags |= rec_screen;
+  }
+  for(int i = 0; i < PIX_COUNT; i++) {
+    colorDelta[i] = f.colors[i] ^ last.colors[i];
+    if(colorDelta[i])
+      flags |= rec_colors;
+  }
+  if(f.keys != last.keys)
+    flags |= rec_keys;
+  if(flags == 0) {
+    repeats++;
+    return;
+  }
+
+  flushRepeats();
+  buffer.clear();
+  buffer.push_back(rec_frame | flags);
+  if(flags & rec_keys)
+    putVarint(buffer, f.keys);
+  if(flags & rec_screen)
+    putDelta(buffer, bitDelta, PIX_COUNT / 8);
+  if(flags & rec_colors)
+    putDelta(buffer, colorDelta, PIX_COUNT);
+  out.write((const char *)&buffer[0], buffer.size());
+  last = f;
+  return;
+}
+
+void Recorder::close() {
+  if(!queue)
+    return;
+  running = false;
+  wake.notify_one();
+  worker.join();
+  flushRepeats();
+  uint8_t end = rec_end;
+  out.write((const char *)&end, 1);
+  out.close();
+  if(dropped)
+    std::cout << "Recording dropped " << dropped << " frames\n";
+  delete[] queue;
+  queue = NULL;
+  return;
+}
+
+RecordingReader::RecordingReader() {
+  width = 0;
+  height = 0;
+  fps = REC_FPS;
+  repeats = 0;
+  done = true;
+  memset(&current, 0, sizeof(current));
+}
+
+bool RecordingReader::readVarint(uint32_t &value) {
+  value = 0;
+  for(int shift = 0; shift < 35; shift += 7) {
+    int byte = in.get();
+    if(byte == EOF)
+      return false;
+    value |= (uint32_t)(byte & 0x7F) << shift;
+    if(!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+bool RecordingReader::readDelta(uint8_t *plane, int size) {
+  int pos = 0;
+  while(pos < size) {
+    uint32_t zeros, count;
+    if(!readVarint(zeros) || !readVarint(count))
+      return false;
+    if(zeros > (uint32_t)(size - pos) || count > (uint32_t)(size - pos) - zeros)
+      return false;
+    pos += zeros;
+    for(uint32_t i = 0; i < count; i++) {
+      int byte = in.get();
+      if(byte == EOF)
+        return false;
+      plane[pos++] ^= byte;
+    }
+  }
+  return true;
+}
+
+int RecordingReader::open(const char *path) {
+  in.open(path, std::ios::in | std::ios::binary);
+  if(!in.good())
+    return -1;
+  char magic[5];
+  in.read(magic, 5);
+  if(!in.good() || memcmp(magic, "C8RC", 4) != 0 || magic[4] != REC_VERSION) {
+    std::cout << path << " is not a chipper recording\n";
+    return -1;
+  }
+  uint32_t w, h, f, colorCount;
+  if(!readVarint(w) || !readVarint(h) || !readVarint(f) || !readVarint(colorCount))
+    return -1;
+  if(w != PIX_WIDTH || h != PIX_HEIGHT || colorCount < 1 || colorCount > 256) {
+    std::cout << "Unsupported recording " << w << "x" << h << "\n";
+    return -1;
+  }
+  width = w;
+  height = h;
+  fps = f ? f : REC_FPS;
+  palette.clear();
+  for(uint32_t i = 0; i < colorCount; i++) {
+    uint8_t rgb[3];
+    in.read((char *)rgb, 3);
+    palette.push_back((rgb[0] << 16) | (rgb[1] << 8) | rgb[2]);
+  }
+  if(!in.good())
+    return -1;
+  memset(&current, 0, sizeof(current));
+  repeats = 0;
+  done = false;
+  return 0;
+}
+
+bool RecordingReader::next(recFrame &frame) {
+  if(repeats > 0) {
+    repeats--;
+    frame = current;
+    return true;
+  }
+  if(done)
+    return false;
+  int record = in.get();
+  if(record == EOF || record == rec_end) {
+    done = true;
+    return false;
+  }
+  if(record == rec_repeat) {
+    uint32_t count;
+    if(!readVarint(count) || count == 0) {
+      done = true;
+      return false;
+    }
+    repeats = count - 1;
+    frame = current;
+    return true;
+  }
+  if(!(record & rec_frame)) {
+    std::cout << "Corrupt recording\n";
+    done = true;
+    return false;
+  }
+  bool good = true;
+  if(record & rec_keys) {
+    uint32_t keys;
+    good = readVarint(keys);
+    current.keys = keys;
+  }
+  if(good && (record & rec_screen))
+    good = readDelta(current.bits, PIX_COUNT / 8);
+  if(good && (record & rec_colors))
+    good = readDelta(current.colors, PIX_COUNT);
+  if(!good) {
+    std::cout << "Recording ends early\n";
+    done = true;
+    return false;
+  }
+  frame = current;
+  return true;
+}
+
+void RecordingReader::toARGB(const recFrame &frame, uint32_t *argb) {
+  for(int i = 0; i < width * height; i++) {
+    uint32_t color = palette[0];
+    if(frame.bits[i / 8] & (0x80 >> (i % 8))) {
+      size_t index = frame.colors[i] + 1;
+      color = index < palette.size() ? palette[index] : 0x00FF00;
+    }
+    argb[i] = 0xFF000000 | color;
+  }
+  return;
+}
+
+void RecordingReader::toRGB(const recFrame &frame, uint8_t *rgb) {
+  uint32_t argb[PIX_COUNT];
+  toARGB(frame, argb);
+  for(int i = 0; i < width * height; i++) {
+    rgb[i * 3] = (argb[i] >> 16) & 0xFF;
+    rgb[i * 3 + 1] = (argb[i] >> 8) & 0xFF;
+    rgb[i * 3 + 2] = argb[i] & 0xFF;
+  }
+  return;
+}
+
+int RecordingReader::getWidth() {
+  return width;
+}
+
+int RecordingReader::getHeight() {
+  return height;
+}
+
+int RecordingReader::getFps() {
+  return fps;
+}
+
+const std::vector<uint32_t> &RecordingReader::getPalette() {
+  return palette;
+}
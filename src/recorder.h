@@ -0,0 +1,109 @@
+#ifndef _RECORDER_
+#define _RECORDER_
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "chip8.h"
+
+//Gameplay recordings (.c8rec). One frame per 60Hz tick, stored as the
+//XOR of the screen bitplane against the frame before it, run length and
+//varint coded, along with the key state. Still screens cost nothing but
+//a frame count, so a minute of play is usually a few KB.
+//
+//File layout, all numbers are LEB128 varints unless noted:
+//  "C8RC" version(byte) width height fps colorCount {r g b bytes}*colorCount
+//  then records until END:
+//    0x00              END
+//    0x01 n            n frames exactly like the one before
+//    0x80|flags        one frame. flags: 1 screen changed, 2 colors changed,
+//                      4 keys changed. Followed by, in this order,
+//                      keys, screen delta (w*h/8 bytes), color delta (w*h bytes)
+//  A delta is runs of (zeros, count, count literal bytes) until w*h/8 (or
+//  w*h) bytes are covered. The color plane holds palette index - 1 for lit
+//  pixels, so single color games never have a color delta.
+
+#define REC_VERSION 1
+#define REC_FPS 60
+#define REC_QUEUE 256 //frames the writer can fall behind before dropping
+
+enum recRecords {
+  rec_end = 0x00,
+  rec_repeat = 0x01,
+  rec_frame = 0x80
+};
+
+enum recFlags {
+  rec_screen = 1,
+  rec_colors = 2,
+  rec_keys = 4
+};
+
+//one decoded frame
+struct recFrame {
+  uint8_t bits[PIX_COUNT / 8]; //MSB is leftmost
+  uint8_t colors[PIX_COUNT]; //palette index - 1 of lit pixels
+  uint16_t keys;
+};
+
+class Recorder {
+  public:
+    Recorder();
+    ~Recorder();
+    //palette[0] is the background, palette[1] the default draw color
+    int open(const char *path, const uint32_t *palette, int colorCount);
+    //called by the emulator once a frame. Never waits on the disk.
+    void addFrame(Chip8 &cpu, uint16_t keys);
+    void close();
+    bool isOpen();
+    int getDropped();
+  private:
+    void writer();
+    void encode(const recFrame &);
+    void flushRepeats();
+    std::ofstream out;
+    std::vector<uint32_t> palette;
+    std::thread worker;
+    std::mutex waitLock;
+    std::condition_variable wake;
+    std::atomic<bool> running;
+    //single producer, single consumer ring
+    recFrame *queue;
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+    int dropped;
+    //writer thread state
+    recFrame last;
+    uint32_t repeats;
+    std::vector<uint8_t> buffer;
+};
+
+class RecordingReader {
+  public:
+    RecordingReader();
+    int open(const char *path);
+    bool next(recFrame &); //false at the end
+    void toRGB(const recFrame &, uint8_t *rgb); //w*h*3 bytes
+    void toARGB(const recFrame &, uint32_t *argb);
+    int getWidth();
+    int getHeight();
+    int getFps();
+    const std::vector<uint32_t> &getPalette();
+  private:
+    bool readVarint(uint32_t &);
+    bool readDelta(uint8_t *plane, int size);
+    std::ifstream in;
+    std::vector<uint32_t> palette;
+    int width;
+    int height;
+    int fps;
+    recFrame current;
+    uint32_t repeats;
+    bool done;
+};
+
+#endif
@@ -0,0 +1,195 @@
+#include "romlib.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//FNV-1a, 64 bit
+uint64_t romHash(const uint8_t *rom, size_t size) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for(size_t i = 0; i < size; i++) {
+    hash ^= rom[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static bool entryLess(const romEntry &a, const romEntry &b) {
+  return a.hash < b.hash;
+}
+
+int writeRomIndex(const char *path, const std::vector<romInfo> &roms) {
+  std::vector<romEntry> entries;
+  std::vector<uint8_t> blob;
+  for(size_t i = 0; i < roms.size(); i++) {
+    const romInfo &info = roms[i];
+    romEntry e;
+    memset(&e, 0, sizeof(e));
+    e.hash = romHash(info.rom.data(), info.rom.size());
+    e.romSize = info.rom.size();
+    e.nameOffset = blob.size();
+    blob.insert(blob.end(), info.name.begin(), info.name.end());
+    blob.push_back(0);
+    e.colorOffset = blob.size();
+    e.colorCount = info.colors.size() / 5;
+    blob.insert(blob.end(), info.colors.begin(), info.colors.begin() + e.colorCount * 5);
+    e.opsPerSec = info.opsPerSec;
+    e.quirks = info.quirks;
+    e.saveSlots = info.saveSlots;
+    memcpy(e.keymap, info.keymap, sizeof(e.keymap));
+    entries.push_back(e);
+  }
+  std::stable_sort(entries.begin(), entries.end(), entryLess);
+  //the same ROM under two names. The first one found wins
+  for(size_t i = 1; i < entries.size(); i++) {
+    if(entries[i].hash == entries[i - 1].hash && entries[i].romSize == entries[i - 1].romSize) {
+      std::cout << "Skipping " << &blob[entries[i].nameOffset] << ", same ROM as "
+                << &blob[entries[i - 1].nameOffset] << "\n";
+      entries.erase(entries.begin() + i);
+      i--;
+    }
+  }
+
+  romLibHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = ROMLIB_MAGIC;
+  header.version = ROMLIB_VERSION;
+  header.count = entries.size();
+  header.entrySize = sizeof(romEntry);
+  header.blobOffset = sizeof(header) + entries.size() * sizeof(romEntry);
+  header.blobSize = blob.size();
+
+  std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+  if(!out.good()) {
+    std::cout << "Error writing index " << path << "\n";
+    return -1;
+  }
+  out.write((const char *)&header, sizeof(header));
+  out.write((const char *)entries.data(), entries.size() * sizeof(romEntry));
+  out.write((const char *)blob.data(), blob.size());
+  if(!out.good()) {
+    std::cout << "Error writing index " << path << "\n";
+    return -1;
+  }
+  return entries.size();
+}
+
+RomIndex::RomIndex() {
+  base = NULL;
+  mapSize = 0;
+  header = NULL;
+  entries = NULL;
+  blob = NULL;
+}
+
+RomIndex::~RomIndex() {
+  close();
+}
+
+#ifndef _WIN32
+int RomIndex::open(const char *path) {
+  close();
+  int fd = ::open(path, O_RDONLY);
+  if(fd < 0) {
+    std::cout << "Error opening index " << path << "\n";
+    return -1;
+  }
+  struct stat info;
+  if(fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(romLibHeader)) {
+    std::cout << path << " is not a chipper index\n";
+    ::close(fd);
+    return -1;
+  }
+  void *mem = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  //the mapping keeps the file, the descriptor isn't needed
+  ::close(fd);
+  if(mem == MAP_FAILED) {
+    std::cout << "Error mapping index " << path << "\n";
+    return -1;
+  }
+  base = (const uint8_t *)mem;
+  mapSize = info.st_size;
+  header = (const romLibHeader *)base;
+  if(header->magic != ROMLIB_MAGIC || header->version != ROMLIB_VERSION || header->entrySize != sizeof(romEntry)
+     || header->blobOffset < sizeof(romLibHeader) + (uint64_t)header->count * sizeof(romEntry)
+     || (uint64_t)header->blobOffset + header->blobSize > mapSize) {
+    std::cout << path << " is not a chipper " << ROMLIB_VERSION << " index\n";
+    close();
+    return -1;
+  }
+  entries = (const romEntry *)(base + sizeof(romLibHeader));
+  blob = base + header->blobOffset;
+  return 0;
+}
+
+void RomIndex::close() {
+  if(base)
+    munmap((void *)base, mapSize);
+  base = NULL;
+  mapSize = 0;
+  header = NULL;
+  entries = NULL;
+  blob = NULL;
+  return;
+}
+#else
+//no mmap on windows
+int RomIndex::open(const char *path) {
+  std::cout << "ROM indexes are not supported on this platform (" << path << ")\n";
+  return -1;
+}
+
+void RomIndex::close() {
+  return;
+}
+#endif
+
+bool RomIndex::isOpen() {
+  return base != NULL;
+}
+
+int RomIndex::getCount() {
+  return header ? header->count : 0;
+}
+
+const romEntry *RomIndex::getEntry(int i) {
+  if(i < 0 || i >= getCount())
+    return NULL;
+  return &entries[i];
+}
+
+const romEntry *RomIndex::find(const uint8_t *rom, size_t size) {
+  if(!header)
+    return NULL;
+  romEntry key;
+  key.hash = romHash(rom, size);
+  const romEntry *end = entries + header->count;
+  const romEntry *e = std::lower_bound(entries, end, key, entryLess);
+  for(; e != end && e->hash == key.hash; e++) {
+    if(e->romSize == size)
+      return e;
+  }
+  return NULL;
+}
+
+const char *RomIndex::getName(const romEntry *e) {
+  if(!e || e->nameOffset >= header->blobSize)
+    return "";
+  //names are written NUL terminated, a damaged file may not be
+  if(!memchr(blob + e->nameOffset, 0, header->blobSize - e->nameOffset))
+    return "";
+  return (const char *)blob + e->nameOffset;
+}
+
+//e->colorCount 5 byte colors, or NULL if the index is damaged
+const uint8_t *RomIndex::getColors(const romEntry *e) {
+  if(!e || (uint64_t)e->colorOffset + e->colorCount * 5 > header->blobSize)
+    return NULL;
+  return blob + e->colorOffset;
+}
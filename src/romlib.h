@@ -0,0 +1,91 @@
+#ifndef _ROMLIB_
+#define _ROMLIB_
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//ROM library index. chipper-index scans a ROM directory once and writes
+//everything chipper wants to know about each ROM into one file, keyed by
+//a hash of the ROM's contents, so renaming a ROM loses nothing and
+//startup is a map and a binary search instead of file lookups and
+//parsing.
+//
+//Layout: romLibHeader, then count romEntry records sorted by hash, then
+//a blob holding the names (NUL terminated) and colors (clr file layout,
+//5 bytes each).
+
+#define ROMLIB_MAGIC 0x58493843 //"C8IX"
+#define ROMLIB_VERSION 1
+
+//behavior differences between chip8 implementations a ROM was written for
+enum romQuirks {
+  quirk_shift = 1, //8XY6/8XYE shift VY into VX
+  quirk_loadstore = 2, //FX55/FX65 leave I at I+X+1
+  quirk_jump = 4, //BXNN jumps to VX+XNN
+  quirk_vfreset = 8, //8XY1/2/3 clear VF
+  quirk_clip = 16 //sprites clip at the screen edge instead of wrapping
+};
+
+struct romLibHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t count;
+  uint32_t entrySize; //sizeof(romEntry) as the index was written
+  uint32_t blobOffset;
+  uint32_t blobSize;
+  uint32_t pad[2];
+};
+
+struct romEntry {
+  uint64_t hash; //romHash of the contents
+  uint32_t romSize;
+  uint32_t nameOffset; //into the blob
+  uint32_t colorOffset; //into the blob
+  uint16_t colorCount; //0 = no custom colors
+  uint16_t opsPerSec; //0 = chipper's default
+  uint16_t quirks; //romQuirks
+  uint8_t saveSlots;
+  uint8_t pad;
+  char keymap[16]; //keyboard key for chip8 key 0-F, 0 = default
+  uint32_t reserved;
+};
+
+uint64_t romHash(const uint8_t *rom, size_t size);
+
+//what chipper-index collects per ROM before writing
+struct romInfo {
+  std::string name;
+  std::vector<uint8_t> rom;
+  std::vector<uint8_t> colors; //clr file contents
+  int opsPerSec;
+  int quirks;
+  int saveSlots;
+  char keymap[16];
+};
+
+//returns how many entries were written (duplicate ROMs are dropped) or -1
+int writeRomIndex(const char *path, const std::vector<romInfo> &roms);
+
+//read side, the file stays mapped while open
+class RomIndex {
+  public:
+    RomIndex();
+    ~RomIndex();
+    int open(const char *path);
+    void close();
+    bool isOpen();
+    int getCount();
+    const romEntry *getEntry(int);
+    const romEntry *find(const uint8_t *rom, size_t size);
+    const char *getName(const romEntry *);
+    const uint8_t *getColors(const romEntry *);
+  private:
+    const uint8_t *base;
+    size_t mapSize;
+    const romLibHeader *header;
+    const romEntry *entries;
+    const uint8_t *blob;
+};
+
+#endif
@@ -0,0 +1,392 @@
+#include "scaler.h"
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#define SCALER_X86
+#include <immintrin.h>
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+//Kernels. Every kernel has a plain C++ version, and on x86 an SSE2 and
+//an AVX2 version picked at runtime. The pre-filters only ever see the
+//tiny 64x32 image; the expensive part at 1080p/4K is filling the output,
+//so that is where the wide stores matter most.
+
+//fill n pixels with one color
+static void fillRow(uint32_t *dst, int n, uint32_t c) {
+  for(int i = 0; i < n; i++)
+    dst[i] = c;
+}
+
+//write every source pixel k times
+static void expandRow(const uint32_t *src, int n, int k, uint32_t *dst) {
+  for(int i = 0; i < n; i++) {
+    for(int j = 0; j < k; j++)
+      *dst++ = src[i];
+  }
+}
+
+//50% brightness, alpha kept
+static void darkenRow(const uint32_t *src, int n, uint32_t *dst) {
+  for(int i = 0; i < n; i++)
+    dst[i] = ((src[i] >> 1) & 0x007F7F7F) | (src[i] & 0xFF000000);
+}
+
+//Scale2x (identical output to EPX). b, e, h are the rows above, at and
+//below the current one, edge padded so index -1 and w are valid.
+static void scale2xRow(const uint32_t *b, const uint32_t *e, const uint32_t *h,
+                       int w, uint32_t *out0, uint32_t *out1) {
+  for(int x = 0; x < w; x++) {
+    uint32_t B = b[x], D = e[x-1], E = e[x], F = e[x+1], H = h[x];
+    out0[2*x]   = (D == B && B != F && D != H) ? D : E;
+    out0[2*x+1] = (B == F && B != D && F != H) ? F : E;
+    out1[2*x]   = (D == H && D != B && H != F) ? D : E;
+    out1[2*x+1] = (H == F && D != H && B != F) ? F : E;
+  }
+}
+
+#ifdef SCALER_X86
+TARGET_SSE2 static void fillRowSSE2(uint32_t *dst, int n, uint32_t c) {
+  __m128i v = _mm_set1_epi32((int)c);
+  int i = 0;
+  for(; i + 4 <= n; i += 4)
+    _mm_storeu_si128((__m128i *)(dst + i), v);
+  for(; i < n; i++)
+    dst[i] = c;
+}
+
+TARGET_SSE2 static void expandRowSSE2(const uint32_t *src, int n, int k, uint32_t *dst) {
+  if(k < 4) {
+    expandRow(src, n, k, dst);
+    return;
+  }
+  for(int i = 0; i < n; i++) {
+    __m128i v = _mm_set1_epi32((int)src[i]);
+    int j = 0;
+    for(; j + 4 <= k; j += 4)
+      _mm_storeu_si128((__m128i *)(dst + j), v);
+    //overlapping store finishes the run instead of a scalar tail
+    if(j < k)
+      _mm_storeu_si128((__m128i *)(dst + k - 4), v);
+    dst += k;
+  }
+}
+
+TARGET_SSE2 static void darkenRowSSE2(const uint32_t *src, int n, uint32_t *dst) {
+  const __m128i rgb = _mm_set1_epi32(0x007F7F7F);
+  const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+  int i = 0;
+  for(; i + 4 <= n; i += 4) {
+    __m128i p = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i d = _mm_and_si128(_mm_srli_epi32(p, 1), rgb);
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(d, _mm_and_si128(p, alpha)));
+  }
+  darkenRow(src + i, n - i, dst + i);
+}
+
+//mask ? a : b
+TARGET_SSE2 static inline __m128i select128(__m128i mask, __m128i a, __m128i b) {
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+TARGET_SSE2 static void scale2xRowSSE2(const uint32_t *b, const uint32_t *e, const uint32_t *h,
+                                       int w, uint32_t *out0, uint32_t *out1) {
+  int x = 0;
+  for(; x + 4 <= w; x += 4) {
+    __m128i B = _mm_loadu_si128((const __m128i *)(b + x));
+    __m128i D = _mm_loadu_si128((const __m128i *)(e + x - 1));
+    __m128i E = _mm_loadu_si128((const __m128i *)(e + x));
+    __m128i F = _mm_loadu_si128((const __m128i *)(e + x + 1));
+    __m128i H = _mm_loadu_si128((const __m128i *)(h + x));
+    __m128i DB = _mm_cmpeq_epi32(D, B);
+    __m128i BF = _mm_cmpeq_epi32(B, F);
+    __m128i DH = _mm_cmpeq_epi32(D, H);
+    __m128i HF = _mm_cmpeq_epi32(H, F);
+    //every rule is "one pair equal, the two neighbouring pairs different"
+    __m128i e0 = select128(_mm_andnot_si128(_mm_or_si128(BF, DH), DB), D, E);
+    __m128i e1 = select128(_mm_andnot_si128(_mm_or_si128(DB, HF), BF), F, E);
+    __m128i e2 = select128(_mm_andnot_si128(_mm_or_si128(DB, HF), DH), D, E);
+    __m128i e3 = select128(_mm_andnot_si128(_mm_or_si128(DH, BF), HF), F, E);
+    _mm_storeu_si128((__m128i *)(out0 + 2*x), _mm_unpacklo_epi32(e0, e1));
+    _mm_storeu_si128((__m128i *)(out0 + 2*x + 4), _mm_unpackhi_epi32(e0, e1));
+    _mm_storeu_si128((__m128i *)(out1 + 2*x), _mm_unpacklo_epi32(e2, e3));
+    _mm_storeu_si128((__m128i *)(out1 + 2*x + 4), _mm_unpackhi_epi32(e2, e3));
+  }
+  scale2xRow(b + x, e + x, h + x, w - x, out0 + 2*x, out1 + 2*x);
+}
+
+TARGET_AVX2 static void fillRowAVX2(uint32_t *dst, int n, uint32_t c) {
+  __m256i v = _mm256_set1_epi32((int)c);
+  int i = 0;
+  for(; i + 8 <= n; i += 8)
+    _mm256_storeu_si256((__m256i *)(dst + i), v);
+  for(; i < n; i++)
+    dst[i] = c;
+}
+
+TARGET_AVX2 static void expandRowAVX2(const uint32_t *src, int n, int k, uint32_t *dst) {
+  if(k < 8) {
+    expandRowSSE2(src, n, k, dst);
+    return;
+  }
+  for(int i = 0; i < n; i++) {
+    __m256i v = _mm256_set1_epi32((int)src[i]);
+    int j = 0;
+    for(; j + 8 <= k; j += 8)
+      _mm256_storeu_si256((__m256i *)(dst + j), v);
+    if(j < k)
+      _mm256_storeu_si256((__m256i *)(dst + k - 8), v);
+    dst += k;
+  }
+}
+
+TARGET_AVX2 static void darkenRowAVX2(const uint32_t *src, int n, uint32_t *dst) {
+  const __m256i rgb = _mm256_set1_epi32(0x007F7F7F);
+  const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+  int i = 0;
+  for(; i + 8 <= n; i += 8) {
+    __m256i p = _mm256_loadu_si256((const __m256i *)(src + i));
+    __m256i d = _mm256_and_si256(_mm256_srli_epi32(p, 1), rgb);
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_or_si256(d, _mm256_and_si256(p, alpha)));
+  }
+  darkenRow(src + i, n - i, dst + i);
+}
+
+TARGET_AVX2 static inline __m256i select256(__m256i mask, __m256i a, __m256i b) {
+  return _mm256_blendv_epi8(b, a, mask);
+}
+
+TARGET_AVX2 static void scale2xRowAVX2(const uint32_t *b, const uint32_t *e, const uint32_t *h,
+                                       int w, uint32_t *out0, uint32_t *out1) {
+  int x = 0;
+  for(; x + 8 <= w; x += 8) {
+    __m256i B = _mm256_loadu_si256((const __m256i *)(b + x));
+    __m256i D = _mm256_loadu_si256((const __m256i *)(e + x - 1));
+    __m256i E = _mm256_loadu_si256((const __m256i *)(e + x));
+    __m256i F = _mm256_loadu_si256((const __m256i *)(e + x + 1));
+    __m256i H = _mm256_loadu_si256((const __m256i *)(h + x));
+    __m256i DB = _mm256_cmpeq_epi32(D, B);
+    __m256i BF = _mm256_cmpeq_epi32(B, F);
+    __m256i DH = _mm256_cmpeq_epi32(D, H);
+    __m256i HF = _mm256_cmpeq_epi32(H, F);
+    __m256i e0 = select256(_mm256_andnot_si256(_mm256_or_si256(BF, DH), DB), D, E);
+    __m256i e1 = select256(_mm256_andnot_si256(_mm256_or_si256(DB, HF), BF), F, E);
+    __m256i e2 = select256(_mm256_andnot_si256(_mm256_or_si256(DB, HF), DH), D, E);
+    __m256i e3 = select256(_mm256_andnot_si256(_mm256_or_si256(DH, BF), HF), F, E);
+    //unpack works per 128 bit lane, so put the lanes back in order after
+    __m256i lo = _mm256_unpacklo_epi32(e0, e1);
+    __m256i hi = _mm256_unpackhi_epi32(e0, e1);
+    _mm256_storeu_si256((__m256i *)(out0 + 2*x), _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256((__m256i *)(out0 + 2*x + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+    lo = _mm256_unpacklo_epi32(e2, e3);
+    hi = _mm256_unpackhi_epi32(e2, e3);
+    _mm256_storeu_si256((__m256i *)(out1 + 2*x), _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256((__m256i *)(out1 + 2*x + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+  }
+  scale2xRowSSE2(b + x, e + x, h + x, w - x, out0 + 2*x, out1 + 2*x);
+}
+#endif
+
+//AdvMAME3x/Scale3x. Only runs on the 64x32 source, plain C++ is plenty.
+static void scale3x(const uint32_t *pad, int w, int h, uint32_t *out) {
+  int pw = w + 2;
+  int ow = w * 3;
+  for(int y = 0; y < h; y++) {
+    const uint32_t *b = pad + y * pw + 1;
+    const uint32_t *e = b + pw;
+    const uint32_t *hr = e + pw;
+    uint32_t *o0 = out + (y * 3) * ow;
+    uint32_t *o1 = o0 + ow;
+    uint32_t *o2 = o1 + ow;
+    for(int x = 0; x < w; x++) {
+      uint32_t A = b[x-1], B = b[x], C = b[x+1];
+      uint32_t D = e[x-1], E = e[x], F = e[x+1];
+      uint32_t G = hr[x-1], H = hr[x], I = hr[x+1];
+      bool db = D == B && B != F && D != H;
+      bool bf = B == F && B != D && F != H;
+      bool dh = D == H && D != B && H != F;
+      bool hf = H == F && D != H && B != F;
+      o0[3*x]   = db ? D : E;
+      o0[3*x+1] = (db && E != C) || (bf && E != A) ? B : E;
+      o0[3*x+2] = bf ? F : E;
+      o1[3*x]   = (db && E != G) || (dh && E != A) ? D : E;
+      o1[3*x+1] = E;
+      o1[3*x+2] = (bf && E != I) || (hf && E != C) ? F : E;
+      o2[3*x]   = dh ? D : E;
+      o2[3*x+1] = (dh && E != I) || (hf && E != G) ? H : E;
+      o2[3*x+2] = hf ? F : E;
+    }
+  }
+}
+
+static int cpuSimd() {
+#ifdef SCALER_X86
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2"))
+    return simd_avx2;
+  if(__builtin_cpu_supports("sse2"))
+    return simd_sse2;
+#endif
+  return simd_none;
+}
+
+Scaler::Scaler() {
+  mode = scale_nearest;
+  simd = cpuSimd();
+  memset(padded, 0, sizeof(padded));
+  memset(work, 0, sizeof(work));
+}
+
+void Scaler::setMode(int newMode) {
+  if(newMode >= 0 && newMode < scale_modes)
+    mode = newMode;
+  return;
+}
+
+int Scaler::getMode() {
+  return mode;
+}
+
+const char *Scaler::modeName(int m) {
+  switch(m) {
+    case scale_nearest:
+      return "nearest";
+    case scale_2x:
+      return "scale2x";
+    case scale_3x:
+      return "scale3x";
+    case scale_scanline:
+      return "scanline";
+    default:
+      return "unknown";
+  }
+}
+
+bool Scaler::setModeByName(const char *name) {
+  //EPX and Scale2x give the exact same picture, so epx is just another name
+  if(strcmp(name, "epx") == 0) {
+    mode = scale_2x;
+    return true;
+  }
+  for(int i = 0; i < scale_modes; i++) {
+    if(strcmp(name, modeName(i)) == 0) {
+      mode = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+void Scaler::setSimd(int level) {
+  int best = cpuSimd();
+  simd = level > best ? best : level;
+  if(simd < simd_none)
+    simd = simd_none;
+  return;
+}
+
+int Scaler::getSimd() {
+  return simd;
+}
+
+void Scaler::scale(const uint32_t *src, int srcW, int srcH,
+                   uint32_t *dst, int dstW, int dstH, int pitch, uint32_t bg) {
+  void (*fill)(uint32_t *, int, uint32_t) = fillRow;
+  void (*expand)(const uint32_t *, int, int, uint32_t *) = expandRow;
+  void (*darken)(const uint32_t *, int, uint32_t *) = darkenRow;
+  void (*s2x)(const uint32_t *, const uint32_t *, const uint32_t *, int, uint32_t *, uint32_t *) = scale2xRow;
+#ifdef SCALER_X86
+  if(simd == simd_avx2) {
+    fill = fillRowAVX2;
+    expand = expandRowAVX2;
+    darken = darkenRowAVX2;
+    s2x = scale2xRowAVX2;
+  } else if(simd == simd_sse2) {
+    fill = fillRowSSE2;
+    expand = expandRowSSE2;
+    darken = darkenRowSSE2;
+    s2x = scale2xRowSSE2;
+  }
+#endif
+  if(srcW > SCALE_MAX_W || srcH > SCALE_MAX_H || dstW <= 0 || dstH <= 0)
+    return;
+
+  //pick the pre-filter, then the biggest whole number that still fits
+  int pre = 1;
+  if(mode == scale_2x)
+    pre = 2;
+  else if(mode == scale_3x)
+    pre = 3;
+  if(srcW * pre > dstW || srcH * pre > dstH)
+    pre = 1;
+
+  if(srcW > dstW || srcH > dstH) {
+    //window smaller than the chip8 screen. Just sample it.
+    for(int y = 0; y < dstH; y++) {
+      uint32_t *row = (uint32_t *)((uint8_t *)dst + y * pitch);
+      for(int x = 0; x < dstW; x++)
+        row[x] = src[(y * srcH / dstH) * srcW + x * srcW / dstW];
+    }
+    return;
+  }
+
+  const uint32_t *img = src;
+  if(pre > 1) {
+    //edge padded copy so the kernels never need bounds checks
+    int pw = srcW + 2;
+    for(int y = 0; y < srcH + 2; y++) {
+      int sy = y == 0 ? 0 : (y > srcH ? srcH - 1 : y - 1);
+      uint32_t *row = padded + y * pw;
+      memcpy(row + 1, src + sy * srcW, srcW * sizeof(uint32_t));
+      row[0] = row[1];
+      row[srcW + 1] = row[srcW];
+    }
+    if(pre == 2) {
+      for(int y = 0; y < srcH; y++) {
+        const uint32_t *e = padded + (y + 1) * pw + 1;
+        s2x(e - pw, e, e + pw, srcW, work + (2*y) * 2*srcW, work + (2*y+1) * 2*srcW);
+      }
+    } else {
+      scale3x(padded, srcW, srcH, work);
+    }
+    img = work;
+  }
+  int imgW = srcW * pre;
+  int imgH = srcH * pre;
+
+  int k = dstW / imgW;
+  if(dstH / imgH < k)
+    k = dstH / imgH;
+  int outW = imgW * k;
+  int outH = imgH * k;
+  int x0 = (dstW - outW) / 2;
+  int y0 = (dstH - outH) / 2;
+  //scanlines take the bottom quarter of every pixel row
+  int dark = 0;
+  if(mode == scale_scanline && k >= 2)
+    dark = k / 4 > 0 ? k / 4 : 1;
+
+  for(int y = 0; y < y0; y++)
+    fill((uint32_t *)((uint8_t *)dst + y * pitch), dstW, bg);
+  for(int y = y0 + outH; y < dstH; y++)
+    fill((uint32_t *)((uint8_t *)dst + y * pitch), dstW, bg);
+
+  for(int r = 0; r < imgH; r++) {
+    int y = y0 + r * k;
+    uint32_t *first = (uint32_t *)((uint8_t *)dst + y * pitch);
+    fill(first, x0, bg);
+    expand(img + r * imgW, imgW, k, first + x0);
+    fill(first + x0 + outW, dstW - x0 - outW, bg);
+    for(int j = 1; j < k; j++) {
+      uint32_t *row = (uint32_t *)((uint8_t *)dst + (y + j) * pitch);
+      if(j >= k - dark) {
+        fill(row, x0, bg);
+        darken(first + x0, outW, row + x0);
+        fill(row + x0 + outW, dstW - x0 - outW, bg);
+      } else {
+        memcpy(row, first, dstW * sizeof(uint32_t));
+      }
+    }
+  }
+  return;
+}
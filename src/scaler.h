@@ -0,0 +1,47 @@
+#ifndef _SCALER_
+#define _SCALER_
+#include <cstdint>
+
+//largest pre-filter factor (scale3x) and the largest source we expect
+#define SCALE_MAX_PRE 3
+#define SCALE_MAX_W 64
+#define SCALE_MAX_H 32
+
+enum scaleModes {
+  scale_nearest,
+  scale_2x,
+  scale_3x,
+  scale_scanline,
+  scale_modes
+};
+
+enum simdLevels {
+  simd_none,
+  simd_sse2,
+  simd_avx2
+};
+
+//CPU scaling stage. Takes the small ARGB8888 chip8 image and blows it up
+//into a (much) bigger ARGB8888 buffer, normally a locked streaming texture.
+//The image is always scaled by a whole number and centered, the rest
+//is filled with the background color.
+class Scaler {
+  public:
+    Scaler();
+    void setMode(int);
+    int getMode();
+    bool setModeByName(const char *);
+    static const char *modeName(int);
+    void setSimd(int); //clamped to what the cpu supports
+    int getSimd();
+    void scale(const uint32_t *src, int srcW, int srcH,
+               uint32_t *dst, int dstW, int dstH, int pitch, uint32_t bg);
+  private:
+    int mode;
+    int simd;
+    //edge padded copy of the source, and the pre-filtered (2x/3x) image
+    uint32_t padded[(SCALE_MAX_W+2)*(SCALE_MAX_H+2)];
+    uint32_t work[SCALE_MAX_W*SCALE_MAX_H*SCALE_MAX_PRE*SCALE_MAX_PRE];
+};
+
+#endif
@@ -0,0 +1,173 @@
+#include "shm.h"
+#include <iostream>
+#include <cstring>
+#include <new>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+ShmLink::ShmLink() {
+  fd = -1;
+  owner = false;
+  seg = NULL;
+}
+
+ShmLink::~ShmLink() {
+  close();
+}
+
+#ifndef _WIN32
+int ShmLink::create(const char *name) {
+  close();
+  path = std::string("/chipper-") + name;
+  fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if(fd < 0) {
+    std::cout << "Error creating shared memory " << path << "\n";
+    return -1;
+  }
+  if(ftruncate(fd, sizeof(shmSegment)) != 0) {
+    std::cout << "Error sizing shared memory " << path << "\n";
+    ::close(fd);
+    shm_unlink(path.c_str());
+    fd = -1;
+    return -1;
+  }
+  void *mem = mmap(NULL, sizeof(shmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if(mem == MAP_FAILED) {
+    std::cout << "Error mapping shared memory " << path << "\n";
+    ::close(fd);
+    shm_unlink(path.c_str());
+    fd = -1;
+    return -1;
+  }
+  owner = true;
+  //fresh segment is zero filled, seq 0 means nothing published yet
+  seg = new (mem) shmSegment;
+  seg->seq.store(0, std::memory_order_relaxed);
+  seg->keys.store(0, std::memory_order_relaxed);
+  seg->size = sizeof(shmSegment);
+  seg->version = SHM_VERSION;
+  //magic last, consumers check it before anything else
+  std::atomic_thread_fence(std::memory_order_release);
+  seg->magic = SHM_MAGIC;
+  return 0;
+}
+
+int ShmLink::attach(const char *name) {
+  close();
+  path = std::string("/chipper-") + name;
+  fd = shm_open(path.c_str(), O_RDWR, 0);
+  if(fd < 0)
+    return -1;
+  struct stat info;
+  if(fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(shmSegment)) {
+    ::close(fd);
+    fd = -1;
+    return -1;
+  }
+  void *mem = mmap(NULL, sizeof(shmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if(mem == MAP_FAILED) {
+    ::close(fd);
+    fd = -1;
+    return -1;
+  }
+  seg = (shmSegment *)mem;
+  if(seg->magic != SHM_MAGIC || seg->version != SHM_VERSION || seg->size != sizeof(shmSegment)) {
+    std::cout << "Shared memory " << path << " is not a chipper " << SHM_VERSION << " segment\n";
+    close();
+    return -1;
+  }
+  return 0;
+}
+
+void ShmLink::close() {
+  if(seg)
+    munmap((void *)seg, sizeof(shmSegment));
+  if(fd >= 0)
+    ::close(fd);
+  if(owner)
+    shm_unlink(path.c_str());
+  seg = NULL;
+  fd = -1;
+  owner = false;
+  return;
+}
+#else
+//no POSIX shared memory on windows
+int ShmLink::create(const char *name) {
+  std::cout << "Shared memory mode is not supported on this platform (" << name << ")\n";
+  return -1;
+}
+
+int ShmLink::attach(const char *name) {
+  (void)name;
+  return -1;
+}
+
+void ShmLink::close() {
+  return;
+}
+#endif
+
+bool ShmLink::isOpen() {
+  return seg != NULL;
+}
+
+shmSegment *ShmLink::segment() {
+  return seg;
+}
+
+void ShmLink::publish(Chip8 &cpu, uint64_t frame, uint32_t background) {
+  if(!seg)
+    return;
+  uint32_t seq = seg->seq.load(std::memory_order_relaxed);
+  seg->seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  shmState &s = seg->state;
+  s.frame = frame;
+  s.width = PIX_WIDTH;
+  s.height = PIX_HEIGHT;
+  cpu.getRegs(s.regs);
+  memcpy(s.packed, cpu.getState().display, sizeof(s.packed));
+  for(int i = 0; i < PIX_COUNT; i++) {
+    int pix = cpu.getPixel(i);
+    s.argb[i] = pix ? 0xFF000000 | pix : background;
+  }
+
+  seg->seq.store(seq + 2, std::memory_order_release);
+  return;
+}
+
+bool ShmLink::read(shmState &out) {
+  if(!seg)
+    return false;
+  uint32_t before, after;
+  do {
+    before = seg->seq.load(std::memory_order_acquire);
+    if(before == 0)
+      return false;
+    if(before & 1)
+      continue;
+    memcpy(&out, (const void *)&seg->state, sizeof(shmState));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = seg->seq.load(std::memory_order_relaxed);
+  } while((before & 1) || before != after);
+  return true;
+}
+
+uint32_t ShmLink::getKeys() {
+  if(!seg)
+    return 0;
+  return seg->keys.load(std::memory_order_relaxed);
+}
+
+void ShmLink::setKeys(uint32_t keys) {
+  if(!seg)
+    return;
+  seg->keys.store(keys & 0xFFFF, std::memory_order_relaxed);
+  return;
+}
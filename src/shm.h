@@ -0,0 +1,62 @@
+#ifndef _SHM_
+#define _SHM_
+#include <cstdint>
+#include <atomic>
+#include <string>
+#include "chip8.h"
+
+//Shared memory link. chipper publishes its screen, registers and a frame
+//counter into /dev/shm/chipper-<name> once per 60Hz frame and reads the
+//16 keys back from the same segment, so other programs on the machine
+//can watch and play without screen scraping or sockets.
+//
+//The published state is guarded by a seqlock: seq is odd while chipper
+//writes. Readers read seq, read what they need straight out of the
+//segment, and retry if seq was odd or changed meanwhile (shmRead does this).
+
+#define SHM_MAGIC 0x4D504843 //"CHPM"
+#define SHM_VERSION 1
+
+//what chipper writes every frame
+struct shmState {
+  uint64_t frame; //60Hz frames since the ROM started
+  uint32_t width;
+  uint32_t height;
+  chipRegs regs;
+  uint8_t packed[PIX_COUNT / 8]; //1 bit per pixel, MSB is leftmost
+  uint32_t argb[PIX_COUNT]; //0xAARRGGBB, background for off pixels
+};
+
+struct shmSegment {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size; //sizeof(shmSegment) as chipper built it
+  uint32_t pad;
+  std::atomic<uint32_t> seq;
+  shmState state;
+  //written by consumers. Bit n held down = key n. Own cache line so
+  //writing it never disturbs the readers of state.
+  alignas(64) std::atomic<uint32_t> keys;
+};
+
+class ShmLink {
+  public:
+    ShmLink();
+    ~ShmLink();
+    int create(const char *name); //chipper side, 0 on success
+    int attach(const char *name); //consumer side, 0 on success
+    void close();
+    bool isOpen();
+    void publish(Chip8 &cpu, uint64_t frame, uint32_t background);
+    uint32_t getKeys();
+    void setKeys(uint32_t);
+    bool read(shmState &out); //consistent copy, false if nothing published yet
+    shmSegment *segment();
+  private:
+    int fd;
+    bool owner;
+    std::string path;
+    shmSegment *seg;
+};
+
+#endif
@@ -0,0 +1,363 @@
+//chipper-aot: static recompiler. Reads a ROM, follows its control flow
+//from 0x200 and writes a C++ file with one switch label per basic block.
+//Link the output into chipper (make native ROM=...) and the ROM runs
+//precompiled, see aot.h for how it plugs into the interpreter.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <cstdint>
+#include "disasm.h"
+
+//what an opcode does to the flow of the program
+enum opKinds {
+  op_plain,    //compiled, falls through
+  op_jump,     //1NNN
+  op_call,     //2NNN
+  op_ret,      //00EE
+  op_skip,     //3XNN 4XNN 5XY0 9XY0 EX9E EXA1
+  op_computed, //BNNN, target only known at runtime
+  op_interp,   //left to the interpreter, continues at pc+2
+  op_stop      //0000, ends the game
+};
+
+static uint8_t memory[4096];
+static int romSize = 0;
+
+static bool inRom(int addr) {
+  return addr >= 0x200 && addr + 1 < 0x200 + romSize;
+}
+
+static uint16_t fetch(int addr) {
+  return (memory[addr] << 8) | memory[addr+1];
+}
+
+static int classify(uint16_t op) {
+  switch(op & 0xF000) {
+    case 0x0000:
+      if(op == 0x00E0)
+        return op_plain;
+      if(op == 0x00EE)
+        return op_ret;
+      if(op == 0x0000)
+        return op_stop;
+      return op_interp;
+    case 0x1000:
+      return op_jump;
+    case 0x2000:
+      return op_call;
+    case 0x3000:
+    case 0x4000:
+    case 0x5000:
+    case 0x9000:
+      return op_skip;
+    case 0xb000:
+      return op_computed;
+    case 0xd000:
+      //drawing needs the colors, find mode etc. The interpreter does it
+      return op_interp;
+    case 0xe000:
+      if((op & 0x00FF) == 0x9E || (op & 0x00FF) == 0xA1)
+        return op_skip;
+      return op_interp;
+    case 0xf000:
+      switch(op & 0x00FF) {
+        case 0x07:
+        case 0x15:
+        case 0x18:
+        case 0x1E:
+        case 0x29:
+        case 0x65:
+          return op_plain;
+        default:
+          //FX0A waits on keys, FX33/FX55 store to memory
+          return op_interp;
+      }
+    default:
+      return op_plain;
+  }
+}
+
+static std::string hex(int value) {
+  std::stringstream ss;
+  ss << "0x" << std::hex << value;
+  return ss.str();
+}
+
+//leaves the block and gives the op at addr to the interpreter
+static std::string bail(int addr, int opsBefore) {
+  std::stringstream ss;
+  ss << "{ pc = " << hex(addr) << "; done += " << opsBefore << "; goto leave; }";
+  return ss.str();
+}
+
+//C++ for one opcode. Mirrors Chip8::executeOp() statement for statement,
+//including its quirks, so both engines give the same results.
+static std::string emit(int addr, uint16_t op, int opsBefore) {
+  std::stringstream ss;
+  int x = (op & 0x0F00) >> 8;
+  int y = (op & 0x00F0) >> 4;
+  int nn = op & 0x00FF;
+  int nnn = op & 0x0FFF;
+  std::string vx = "V[" + std::to_string(x) + "]";
+  std::string vy = "V[" + std::to_string(y) + "]";
+  std::string next = hex(addr + 2);
+  std::string skip = hex(addr + 4);
+  const char *in = "        ";
+
+  switch(op & 0xF000) {
+    case 0x0000:
+      if(op == 0x00E0) {
+        ss << in << "chipClearDisplay(s);\n";
+      } else if(op == 0x00EE) {
+        ss << in << "if(sp == 0) " << bail(addr, opsBefore) << "\n";
+        ss << in << "sp--;\n" << in << "pc = stack[sp];\n";
+      }
+      break;
+    case 0x1000:
+      ss << in << "pc = " << hex(nnn) << ";\n";
+      break;
+    case 0x2000:
+      ss << in << "if(sp >= 16) " << bail(addr, opsBefore) << "\n";
+      ss << in << "stack[sp] = " << next << ";\n" << in << "sp++;\n";
+      ss << in << "pc = " << hex(nnn) << ";\n";
+      break;
+    case 0x3000:
+      ss << in << "pc = " << vx << " == " << hex(nn) << " ? " << skip << " : " << next << ";\n";
+      break;
+    case 0x4000:
+      ss << in << "pc = " << vx << " != " << hex(nn) << " ? " << skip << " : " << next << ";\n";
+      break;
+    case 0x5000:
+      ss << in << "pc = " << vx << " == " << vy << " ? " << skip << " : " << next << ";\n";
+      break;
+    case 0x6000:
+      ss << in << vx << " = " << hex(nn) << ";\n";
+      break;
+    case 0x7000:
+      ss << in << vx << " += " << hex(nn) << ";\n";
+      break;
+    case 0x8000:
+      switch(op & 0x000F) {
+        case 0x0:
+          ss << in << vx << " = " << vy << ";\n";
+          break;
+        case 0x1:
+          ss << in << vx << " |= " << vy << ";\n";
+          break;
+        case 0x2:
+          ss << in << vx << " &= " << vy << ";\n";
+          break;
+        case 0x3:
+          ss << in << vx << " ^= " << vy << ";\n";
+          break;
+        case 0x4:
+          ss << in << "V[15] = " << vx << " + " << vy << " > 0xFF ? 1 : 0;\n";
+          ss << in << vx << " += " << vy << ";\n";
+          break;
+        case 0x5:
+          ss << in << "V[15] = " << vx << " > " << vy << " ? 1 : 0;\n";
+          ss << in << vx << " = (uint8_t)(" << vx << " - " << vy << ");\n";
+          break;
+        case 0x6:
+          ss << in << "V[15] = " << vx << " & 0x01;\n";
+          ss << in << vx << " = " << vx << " >> 1;\n";
+          break;
+        case 0x7:
+          ss << in << "V[15] = " << vx << " > " << vy << " ? 0 : 1;\n";
+          ss << in << vx << " = (uint8_t)(" << vy << " - " << vx << ");\n";
+          break;
+        case 0xe:
+          //the interpreter's MSB test never matches, VF is always cleared
+          ss << in << "V[15] = 0;\n";
+          ss << in << vx << " = " << vx << " << 1;\n";
+          break;
+      }
+      break;
+    case 0x9000:
+      ss << in << "pc = " << vx << " != " << vy << " ? " << skip << " : " << next << ";\n";
+      break;
+    case 0xa000:
+      ss << in << "I = " << hex(nnn) << ";\n";
+      break;
+    case 0xb000:
+      ss << in << "pc = V[0] + " << hex(nnn) << ";\n";
+      break;
+    case 0xc000:
+      ss << in << vx << " = chipRandom(s) & " << hex(nn) << ";\n";
+      break;
+    case 0xe000:
+      if(nn == 0x9E)
+        ss << in << "pc = (s.keys >> (" << vx << " & 0xF)) & 1 ? " << skip << " : " << next << ";\n";
+      else
+        ss << in << "pc = (s.keys >> (" << vx << " & 0xF)) & 1 ? " << next << " : " << skip << ";\n";
+      break;
+    case 0xf000:
+      switch(nn) {
+        case 0x07:
+          ss << in << vx << " = s.delay;\n";
+          break;
+        case 0x15:
+          ss << in << "s.delay = " << vx << ";\n";
+          break;
+        case 0x18:
+          ss << in << "s.sound = " << vx << ";\n";
+          break;
+        case 0x1E:
+          ss << in << "I += " << vx << ";\n";
+          break;
+        case 0x29:
+          //bad fonts get reported by the interpreter
+          ss << in << "if(" << vx << " > 0xF) " << bail(addr, opsBefore) << "\n";
+          ss << in << "I = " << vx << " * 5;\n";
+          break;
+        case 0x65:
+          ss << in << "if(I + " << x << " >= 4096) " << bail(addr, opsBefore) << "\n";
+          for(int i = 0; i <= x; i++)
+            ss << in << "V[" << i << "] = mem[I + " << i << "];\n";
+          break;
+      }
+      break;
+  }
+  return ss.str();
+}
+
+int main(int argc, char **args) {
+  if(argc < 3) {
+    std::cout << "Usage: chipper-aot <rom> <output.cpp>\n";
+    return -1;
+  }
+
+  std::ifstream gameROM(args[1], std::ios::in | std::ios::binary | std::ios::ate);
+  if(!gameROM.good()) {
+    std::cout << "Error opening ROM\n";
+    return -1;
+  }
+  romSize = gameROM.tellg();
+  if(romSize > 0xE00 || romSize <= 0) {
+    std::cout << "ROM too large.\n";
+    return -1;
+  }
+  gameROM.seekg(0);
+  gameROM.read((char *)&memory[0x200], romSize);
+  gameROM.close();
+
+  //recursive descent from the entry point. Leaders are the entry,
+  //every branch target and every address right after a branch.
+  std::set<int> leaders;
+  std::set<int> seen;
+  std::vector<int> work;
+  leaders.insert(0x200);
+  work.push_back(0x200);
+  while(!work.empty()) {
+    int start = work.back();
+    work.pop_back();
+    for(int addr = start; inRom(addr); addr += 2) {
+      if(seen.count(addr))
+        break;
+      seen.insert(addr);
+      uint16_t op = fetch(addr);
+      std::vector<int> targets;
+      int kind = classify(op);
+      if(kind == op_plain)
+        continue;
+      if(kind == op_jump) {
+        targets.push_back(op & 0x0FFF);
+      } else if(kind == op_call) {
+        targets.push_back(op & 0x0FFF);
+        targets.push_back(addr + 2);
+      } else if(kind == op_skip) {
+        targets.push_back(addr + 2);
+        targets.push_back(addr + 4);
+      } else if(kind == op_interp) {
+        targets.push_back(addr + 2);
+      }
+      for(size_t i = 0; i < targets.size(); i++) {
+        if(!leaders.count(targets[i])) {
+          leaders.insert(targets[i]);
+          work.push_back(targets[i]);
+        }
+      }
+      break;
+    }
+  }
+
+  std::string name(args[1]);
+  size_t slash = name.find_last_of("/\\");
+  if(slash != std::string::npos)
+    name = name.substr(slash + 1);
+
+  std::stringstream body;
+  int blocks = 0;
+  int compiled = 0;
+  for(std::set<int>::iterator it = leaders.begin(); it != leaders.end(); it++) {
+    int start = *it;
+    std::stringstream ops;
+    int count = 0;
+    int addr = start;
+    std::string ending;
+    while(true) {
+      if(!inRom(addr) || (addr != start && leaders.count(addr))) {
+        //runs into the next block, the dispatch picks it up
+        ending = "pc = " + hex(addr) + ";\n        done += " + std::to_string(count) + ";\n        continue;\n";
+        break;
+      }
+      uint16_t op = fetch(addr);
+      int kind = classify(op);
+      if(kind == op_interp || kind == op_stop) {
+        ending = "pc = " + hex(addr) + ";\n        done += " + std::to_string(count) + ";\n        goto leave;\n";
+        break;
+      }
+      ops << "        //" << hex(addr) << ": " << disassemble(op) << "\n";
+      ops << emit(addr, op, count);
+      count++;
+      addr += 2;
+      if(kind != op_plain) {
+        ending = "done += " + std::to_string(count) + ";\n        continue;\n";
+        break;
+      }
+    }
+    if(count == 0)
+      continue;
+    blocks++;
+    compiled += count;
+    int last = addr + 1;
+    body << "      case " << hex(start) << ":\n";
+    body << "        if(done + " << count << " > budget";
+    for(int line = start >> 6; line <= (last >> 6); line++)
+      body << (line == (start >> 6) ? " || (" : " | ") << "dirty[" << line << "]";
+    body << "))\n          goto leave;\n";
+    body << ops.str();
+    body << "        " << ending;
+  }
+
+  std::ofstream out(args[2], std::ios::trunc);
+  if(!out.good()) {
+    std::cout << "Error opening " << args[2] << "\n";
+    return -1;
+  }
+  out << "//Generated by chipper-aot from " << name << ". Do not edit.\n";
+  out << "#include <cstring>\n#include \"aot.h\"\n\n";
+  out << "static const uint8_t rom[" << romSize << "] = {";
+  for(int i = 0; i < romSize; i++)
+    out << (i % 16 == 0 ? "\n  " : " ") << hex(memory[0x200 + i]) << ",";
+  out << "\n};\n\n";
+  out << "static int run(chipState &s, const uint8_t *dirty, int budget) {\n";
+  out << "  uint8_t *mem = s.memory;\n  uint8_t *V = s.V;\n  uint16_t *stack = s.stack;\n";
+  out << "  uint16_t pc = s.pc;\n  uint16_t I = s.mem_reg;\n  uint8_t sp = s.sp;\n";
+  out << "  int done = 0;\n";
+  out << "  (void)mem;\n  (void)stack;\n";
+  out << "  for(;;) {\n    switch(pc) {\n";
+  out << body.str();
+  out << "      default:\n        goto leave;\n    }\n  }\n";
+  out << "leave:\n  s.pc = pc;\n  s.mem_reg = I;\n  s.sp = sp;\n  return done;\n}\n\n";
+  out << "static const aotProgram program = { \"" << name << "\", rom, sizeof(rom), run };\n";
+  out << "static aotRegistration registration(&program);\n";
+  out.close();
+
+  std::cout << name << ": " << blocks << " blocks, " << compiled << " of "
+            << seen.size() << " reachable opcodes compiled\n";
+  return 0;
+}
@@ -0,0 +1,153 @@
+//chipper-bench: headless timings for the parts of chipper that can be
+//measured without a window.
+//  chipper-bench           scaler costs and machine state size
+//  chipper-bench <rom>     interpreter (and precompiled) speed
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include "chip8.h"
+#include "scaler.h"
+
+bool DEBUG_MODE = false;
+bool FIND_MODE = false;
+
+static double nowUsec() {
+  using namespace std::chrono;
+  return duration_cast<duration<double, std::micro> >(steady_clock::now().time_since_epoch()).count();
+}
+
+static const char *simdName(int level) {
+  switch(level) {
+    case simd_avx2:
+      return "avx2";
+    case simd_sse2:
+      return "sse2";
+    default:
+      return "scalar";
+  }
+}
+
+//per-frame cost of each scale mode at full HD and 4K
+static void benchScaler() {
+  const int sizes[2][2] = {{1920, 1080}, {3840, 2160}};
+  uint32_t src[PIX_COUNT];
+  //something sprite-like: blocks and diagonals so scale2x/3x have work to do
+  for(int i = 0; i < PIX_COUNT; i++) {
+    int x = i % PIX_WIDTH, y = i / PIX_WIDTH;
+    bool on = ((x / 4 + y / 3) % 3 == 0) || (x == y) || (x == 63 - y);
+    src[i] = on ? 0xFF00FF00 : 0xFF101010;
+  }
+
+  Scaler scaler;
+  int best = scaler.getSimd();
+  std::cout << "Scaler (best simd: " << simdName(best) << ")\n";
+  std::cout << std::fixed << std::setprecision(1);
+  for(int s = 0; s < 2; s++) {
+    int w = sizes[s][0], h = sizes[s][1];
+    std::vector<uint32_t> dst(w * h);
+    std::vector<uint32_t> ref(w * h);
+    for(int m = 0; m < scale_modes; m++) {
+      scaler.setMode(m);
+      for(int level = simd_none; level <= best; level++) {
+        scaler.setSimd(level);
+        scaler.scale(src, PIX_WIDTH, PIX_HEIGHT, &dst[0], w, h, w * 4, 0xFF000000);
+        if(level == simd_none)
+          ref = dst;
+        bool same = memcmp(&ref[0], &dst[0], w * h * 4) == 0;
+
+        int frames = 0;
+        double start = nowUsec();
+        double elapsed = 0;
+        while(elapsed < 200000.0) {
+          scaler.scale(src, PIX_WIDTH, PIX_HEIGHT, &dst[0], w, h, w * 4, 0xFF000000);
+          frames++;
+          elapsed = nowUsec() - start;
+        }
+        std::cout << "  " << w << "x" << h << " " << std::setw(9) << Scaler::modeName(m)
+                  << " " << std::setw(6) << simdName(level) << ": "
+                  << std::setw(8) << elapsed / frames << " us/frame"
+                  << (same ? "" : "  MISMATCH vs scalar") << "\n";
+      }
+    }
+  }
+  return;
+}
+
+//interpreter speed on a ROM, and precompiled speed if chipper-bench was
+//built with make bench-native for that ROM
+static void benchRom(char *path) {
+  const int chunk = 10000;
+  const int total = 5000000;
+  int screens[2][PIX_COUNT];
+  double rates[2] = {0, 0};
+  std::cout << "ROM " << path << "\n";
+  for(int engine = 0; engine < 2; engine++) {
+    //the rng is seeded when the Chip8 is made, so both engines see the same CXNN numbers
+    std::srand(1);
+    Chip8 cpu;
+    if(cpu.loadROM(path)) {
+      std::cout << "Error opening ROM\n";
+      return;
+    }
+    if(engine == 1 && !cpu.hasNative()) {
+      std::cout << "  no precompiled code linked in for this ROM\n";
+      break;
+    }
+    cpu.useNative(engine == 1);
+    int ran = 0;
+    double start = nowUsec();
+    while(ran < total) {
+      ran += chunk;
+      if(cpu.executeOps(chunk) != chip_normal)
+        break;
+    }
+    double elapsed = nowUsec() - start;
+    rates[engine] = ran / elapsed;
+    for(int i = 0; i < PIX_COUNT; i++)
+      screens[engine][i] = cpu.getPixel(i);
+    std::cout << "  " << (engine ? "precompiled" : "interpreter") << ": "
+              << std::setw(8) << rates[engine] << " Mops/s\n";
+    if(engine == 1) {
+      std::cout << "  speedup " << rates[1] / rates[0] << "x, screens "
+                << (memcmp(screens[0], screens[1], sizeof(screens[0])) ? "DIFFER" : "match") << "\n";
+    }
+  }
+  return;
+}
+
+//size of a machine and what it costs to copy one, for search and
+//replay code that keeps many of them around
+static void benchState() {
+  const size_t count = 10000;
+  chipState *states = newStates(count);
+  Chip8 cpu;
+  double start = nowUsec();
+  for(size_t i = 0; i < count; i++)
+    states[i] = cpu.getState();
+  double copyNs = (nowUsec() - start) * 1000.0 / count;
+  start = nowUsec();
+  for(size_t i = 0; i < count; i++)
+    cpu.setState(states[count - 1 - i]);
+  double restoreNs = (nowUsec() - start) * 1000.0 / count;
+  std::cout << "State\n";
+  std::cout << "  sizeof(chipState) " << sizeof(chipState) << " bytes, sizeof(Chip8) "
+            << sizeof(Chip8) << " bytes\n";
+  std::cout << "  " << count << " states: " << count * sizeof(chipState) / 1024 << " KB\n";
+  std::cout << "  clone " << copyNs << " ns, setState " << restoreNs << " ns\n";
+  deleteStates(states);
+  return;
+}
+
+int main(int argc, char **args) {
+  if(argc > 1) {
+    benchRom(args[1]);
+    return 0;
+  }
+  benchScaler();
+  benchState();
+  return 0;
+}
@@ -0,0 +1,275 @@
+//chipper-diff: runs a ROM twice in lockstep, once on the plain interpreter
+//one opcode at a time and once the way chipper runs it (batched
+//executeOps, precompiled blocks when linked in, optionally cloning the
+//state between batches), and compares the state hashes after every
+//batch. Stops at the first opcode where they disagree and prints what
+//differs.
+//  chipper-diff <rom> [rec=<file.c8rec>] [frames=N] [ops=N] [chunk=N] [clone] [interp]
+//    rec=     keys to press, one set per 60Hz frame, from a recording
+//    frames=  how many frames to run (600, or the length of rec)
+//    ops=     opcodes per second (800)
+//    chunk=   opcodes per executeOps batch (1, 64 when precompiled)
+//    clone    copy the state out and back in before every batch
+//    interp   don't use precompiled blocks
+//make diff-native ROM=... builds it with a ROM's precompiled code.
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include "chip8.h"
+#include "recorder.h"
+#include "disasm.h"
+
+bool DEBUG_MODE = false;
+bool FIND_MODE = false;
+
+static double nowUsec() {
+  using namespace std::chrono;
+  return duration_cast<duration<double, std::micro> >(steady_clock::now().time_since_epoch()).count();
+}
+
+struct diffConfig {
+  int chunk;
+  bool clone;
+  chipState *arena; //two slots for clone
+  int slot;
+};
+
+static uint16_t opcodeAt(const chipState &s) {
+  return s.pc + 1 < 4096 ? (s.memory[s.pc] << 8) | s.memory[s.pc + 1] : 0;
+}
+
+//run count opcodes on the configuration being tested
+static int runTest(Chip8 &cpu, diffConfig &config, int count) {
+  if(config.clone) {
+    config.arena[config.slot] = cpu.getState();
+    cpu.setState(config.arena[config.slot]);
+    config.slot ^= 1;
+  }
+  return cpu.executeOps(count);
+}
+
+//run count opcodes on the reference. trace gets pc << 16 | opcode of each
+static int runReference(Chip8 &cpu, int count, std::vector<uint32_t> &trace) {
+  int status = chip_normal;
+  trace.clear();
+  for(int i = 0; i < count && status == chip_normal; i++) {
+    trace.push_back((cpu.getState().pc << 16) | opcodeAt(cpu.getState()));
+    status = cpu.executeOp();
+  }
+  return status;
+}
+
+static void printDiff(const chipState &a, const chipState &b) {
+  std::cout << std::hex << std::setfill('0');
+  std::cout << "               reference  test\n";
+  struct { const char *name; int a; int b; } regs[] = {
+    {"PC", a.pc, b.pc}, {"I", a.mem_reg, b.mem_reg}, {"SP", a.sp, b.sp},
+    {"DT", a.delay, b.delay}, {"ST", a.sound, b.sound}, {"rng", (int)(a.rng >> 24), (int)(b.rng >> 24)}
+  };
+  for(int i = 0; i < 6; i++) {
+    if(regs[i].a != regs[i].b)
+      std::cout << "  " << std::setw(4) << std::setfill(' ') << regs[i].name << std::setfill('0')
+                << "         " << std::setw(4) << regs[i].a << "       " << std::setw(4) << regs[i].b << "\n";
+  }
+  if(a.rng != b.rng)
+    std::cout << "  rng state     " << std::setw(8) << a.rng << "   " << std::setw(8) << b.rng << "\n";
+  for(int i = 0; i < 16; i++) {
+    if(a.V[i] != b.V[i])
+      std::cout << "    V" << i << "           " << std::setw(2) << (int)a.V[i] << "         " << std::setw(2) << (int)b.V[i] << "\n";
+  }
+  for(int i = 0; i < 16; i++) {
+    if(a.stack[i] != b.stack[i])
+      std::cout << "  stack[" << i << "]     " << std::setw(4) << a.stack[i] << "       " << std::setw(4) << b.stack[i] << "\n";
+  }
+  int shown = 0;
+  for(int i = 0; i < 4096; i++) {
+    if(a.memory[i] == b.memory[i])
+      continue;
+    if(shown++ < 16)
+      std::cout << "  mem 0x" << std::setw(3) << i << "      " << std::setw(2) << (int)a.memory[i]
+                << "         " << std::setw(2) << (int)b.memory[i] << "\n";
+  }
+  if(shown > 16)
+    std::cout << "  ... " << std::dec << shown << std::hex << " memory bytes differ\n";
+  std::cout << std::dec << std::setfill(' ');
+  bool rows[PIX_HEIGHT] = {false};
+  int pixels = 0;
+  for(int i = 0; i < PIX_COUNT; i++) {
+    if(chipPixel(a, i) != chipPixel(b, i)) {
+      rows[i / PIX_WIDTH] = true;
+      pixels++;
+    }
+  }
+  if(pixels) {
+    std::cout << "  " << pixels << " pixels differ, rows";
+    for(int y = 0; y < PIX_HEIGHT; y++) {
+      if(rows[y])
+        std::cout << " " << y;
+    }
+    std::cout << "\n";
+  }
+  return;
+}
+
+static bool checkDrift(Chip8 &cpu, const char *name, int frame) {
+  if(chipHashBytes(cpu.getState()) == cpu.getState().hash)
+    return true;
+  std::cout << "Frame " << frame << ": " << name << " running hash no longer matches its memory and display."
+            << " Something stores without updating it\n";
+  return false;
+}
+
+int main(int argc, char **args) {
+  if(argc < 2) {
+    std::cout << "Usage: chipper-diff <rom> [rec=<file.c8rec>] [frames=N] [ops=N] [chunk=N] [clone] [interp]\n";
+    return -1;
+  }
+  const char *recPath = NULL;
+  long frames = -1;
+  int opsPerSec = 800;
+  diffConfig config;
+  config.chunk = 0;
+  config.clone = false;
+  config.slot = 0;
+  bool native = true;
+  for(int i = 2; i < argc; i++) {
+    if(strncmp(args[i], "rec=", 4) == 0)
+      recPath = args[i] + 4;
+    else if(strncmp(args[i], "frames=", 7) == 0)
+      frames = atol(args[i] + 7);
+    else if(strncmp(args[i], "ops=", 4) == 0)
+      opsPerSec = atoi(args[i] + 4);
+    else if(strncmp(args[i], "chunk=", 6) == 0)
+      config.chunk = atoi(args[i] + 6);
+    else if(strcmp(args[i], "clone") == 0)
+      config.clone = true;
+    else if(strcmp(args[i], "interp") == 0)
+      native = false;
+    else
+      std::cout << "Unknown option " << args[i] << "\n";
+  }
+
+  RecordingReader rec;
+  if(recPath && rec.open(recPath)) {
+    std::cout << "Error opening recording " << recPath << "\n";
+    return -1;
+  }
+  if(frames < 0)
+    frames = recPath ? -1 : 600;
+
+  Chip8 ref;
+  Chip8 test;
+  if(ref.loadROM(args[1]) || test.loadROM(args[1])) {
+    std::cout << "Error opening ROM\n";
+    return -1;
+  }
+  //same CXNN numbers on both sides
+  test.setState(ref.getState());
+  ref.useNative(false);
+  test.useNative(native);
+  bool precompiled = native && test.hasNative();
+  if(config.chunk <= 0)
+    config.chunk = precompiled ? 64 : 1;
+  chipState *states = newStates(4);
+  config.arena = states;
+  chipState &beforeRef = states[2];
+  chipState &beforeTest = states[3];
+
+  std::cout << "reference: interpreter, one opcode at a time\n";
+  std::cout << "test: executeOps(" << config.chunk << ")" << (precompiled ? ", precompiled" : ", interpreter")
+            << (config.clone ? ", cloned every batch" : "") << "\n";
+
+  double opsPerFrame = opsPerSec / 60.0;
+  double opsOwed = 0;
+  long totalOps = 0;
+  long frame = 0;
+  int result = 0;
+  double start = nowUsec();
+  recFrame keys;
+  memset(&keys, 0, sizeof(keys));
+  std::vector<uint32_t> trace;
+  trace.reserve(config.chunk);
+  while(frames < 0 || frame < frames) {
+    if(recPath && !rec.next(keys))
+      break;
+    ref.setKeys(keys.keys);
+    test.setKeys(keys.keys);
+    opsOwed += opsPerFrame;
+    int ops = (int)opsOwed;
+    opsOwed -= ops;
+
+    int refStatus = chip_normal;
+    int testStatus = chip_normal;
+    for(int done = 0; done < ops && refStatus == chip_normal; ) {
+      int count = ops - done < config.chunk ? ops - done : config.chunk;
+      if(count > 1) {
+        beforeRef = ref.getState();
+        beforeTest = test.getState();
+      }
+      refStatus = runReference(ref, count, trace);
+      testStatus = runTest(test, config, count);
+      if(ref.getHash() != test.getHash() || refStatus != testStatus) {
+        int first = count;
+        if(count > 1) {
+          //find the first opcode of the batch where they split
+          for(int k = 1; k < count; k++) {
+            ref.setState(beforeRef);
+            test.setState(beforeTest);
+            runReference(ref, k, trace);
+            runTest(test, config, k);
+            if(ref.getHash() != test.getHash()) {
+              first = k;
+              break;
+            }
+          }
+          if(first == count) {
+            ref.setState(beforeRef);
+            test.setState(beforeTest);
+            runReference(ref, count, trace);
+            runTest(test, config, count);
+          }
+        }
+        std::cout << "Diverged in frame " << frame << " at opcode " << totalOps + done + first << "\n";
+        //a precompiled block runs as a unit, so the fault can be anywhere
+        //in it and the last opcode is only where it showed
+        size_t shownOps = precompiled ? 8 : 1;
+        if(precompiled)
+          std::cout << "  in the precompiled block ending at the last of these:\n";
+        for(size_t i = trace.size() > shownOps ? trace.size() - shownOps : 0; i < trace.size(); i++) {
+          uint16_t opcode = trace[i] & 0xFFFF;
+          std::cout << "  0x" << std::hex << std::setfill('0') << std::setw(3) << (trace[i] >> 16) << "  "
+                    << std::setw(4) << opcode << std::dec << std::setfill(' ') << "  " << disassemble(opcode) << "\n";
+        }
+        if(refStatus != testStatus)
+          std::cout << "  status " << refStatus << " vs " << testStatus << "\n";
+        printDiff(ref.getState(), test.getState());
+        result = 1;
+        break;
+      }
+      done += count;
+    }
+    if(result)
+      break;
+    totalOps += ops;
+    ref.timerTick();
+    test.timerTick();
+    frame++;
+    if(!checkDrift(ref, "reference", frame) || !checkDrift(test, "test", frame)) {
+      result = 1;
+      break;
+    }
+    if(refStatus != chip_normal) {
+      std::cout << "Program stopped in frame " << frame << "\n";
+      break;
+    }
+  }
+  double elapsed = nowUsec() - start;
+  if(result == 0)
+    std::cout << frame << " frames, " << totalOps << " opcodes, every hash matched ("
+              << elapsed / 1000.0 << " ms)\n";
+  deleteStates(states);
+  return result;
+}
@@ -0,0 +1,74 @@
+//chipper-export: turns a .c8rec recording into raw RGB frames for
+//offline encoding, or prints what is in it.
+//  chipper-export <recording> info
+//  chipper-export <recording> <out.rgb> [scale]
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include "recorder.h"
+
+bool DEBUG_MODE = false;
+bool FIND_MODE = false;
+
+int main(int argc, char **args) {
+  if(argc < 3) {
+    std::cout << "Usage: chipper-export <recording> info | <out.rgb> [scale]\n";
+    return -1;
+  }
+  RecordingReader reader;
+  if(reader.open(args[1])) {
+    std::cout << "Error opening recording " << args[1] << "\n";
+    return -1;
+  }
+  int w = reader.getWidth();
+  int h = reader.getHeight();
+  recFrame frame;
+
+  if(strcmp(args[2], "info") == 0) {
+    std::ifstream file(args[1], std::ios::in | std::ios::binary | std::ios::ate);
+    long bytes = file.tellg();
+    long frames = 0;
+    while(reader.next(frame))
+      frames++;
+    double minutes = frames / (60.0 * reader.getFps());
+    std::cout << w << "x" << h << " at " << reader.getFps() << " fps, "
+              << reader.getPalette().size() << " colors\n";
+    std::cout << frames << " frames (" << minutes * 60 << " s), " << bytes << " bytes";
+    if(minutes > 0)
+      std::cout << ", " << bytes / minutes / 1024 << " KB/min";
+    std::cout << "\n";
+    return 0;
+  }
+
+  int scale = argc > 3 ? atoi(args[3]) : 1;
+  if(scale < 1)
+    scale = 1;
+  std::ofstream out(args[2], std::ios::out | std::ios::binary | std::ios::trunc);
+  if(!out.good()) {
+    std::cout << "Error opening " << args[2] << "\n";
+    return -1;
+  }
+  std::vector<uint8_t> rgb(w * h * 3);
+  std::vector<uint8_t> scaled(w * scale * h * scale * 3);
+  long frames = 0;
+  while(reader.next(frame)) {
+    reader.toRGB(frame, &rgb[0]);
+    if(scale == 1) {
+      out.write((const char *)&rgb[0], rgb.size());
+    } else {
+      for(int y = 0; y < h * scale; y++) {
+        for(int x = 0; x < w * scale; x++)
+          memcpy(&scaled[(y * w * scale + x) * 3], &rgb[((y / scale) * w + x / scale) * 3], 3);
+      }
+      out.write((const char *)&scaled[0], scaled.size());
+    }
+    frames++;
+  }
+  out.close();
+  std::cout << frames << " frames written. To encode:\n"
+            << "  ffmpeg -f rawvideo -pix_fmt rgb24 -s " << w * scale << "x" << h * scale
+            << " -r " << reader.getFps() << " -i " << args[2] << " out.mp4\n";
+  return 0;
+}
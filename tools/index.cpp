@@ -0,0 +1,178 @@
+//chipper-index: builds and inspects ROM library indexes (chipper ... index=<file>).
+//  chipper-index build <romdir> <out.c8idx> [colordir]   index every .ch8/.c8 in romdir
+//  chipper-index list <index>                           print every entry
+//  chipper-index find <index> <rom>                     look a ROM up by contents
+//
+//Colors come from <colordir>/<name>.clr (./colors by default), the same
+//files chipper looks for by filename. Anything else goes in an optional
+//<romdir>/<name>.cfg next to the ROM, one setting per line:
+//  ops=1200                  opcodes per second
+//  quirks=shift,loadstore    any of shift loadstore jump vfreset clip
+//  keys=x123qweasdzc4rfv     keyboard key for chip8 key 0 through F
+//  saves=4                   save slots
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <dirent.h>
+#include "romlib.h"
+
+bool DEBUG_MODE = false;
+bool FIND_MODE = false;
+
+static const char *quirkNames[] = {"shift", "loadstore", "jump", "vfreset", "clip"};
+
+static bool readFile(const std::string &path, std::vector<uint8_t> &data) {
+  std::ifstream file(path.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+  if(!file.good())
+    return false;
+  long size = file.tellg();
+  if(size < 0)
+    return false;
+  data.resize(size);
+  file.seekg(0);
+  file.read((char *)data.data(), size);
+  return file.good() || size == 0;
+}
+
+static bool endsWith(const std::string &s, const char *suffix) {
+  size_t n = strlen(suffix);
+  return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+static void readSettings(const std::string &path, romInfo &info) {
+  std::ifstream file(path.c_str());
+  std::string line;
+  while(std::getline(file, line)) {
+    size_t eq = line.find('=');
+    if(line.empty() || line[0] == '#' || eq == std::string::npos)
+      continue;
+    std::string key = line.substr(0, eq);
+    std::string value = line.substr(eq + 1);
+    if(key == "ops") {
+      info.opsPerSec = std::min(std::max(atoi(value.c_str()), 0), 0xFFFF);
+    } else if(key == "saves") {
+      info.saveSlots = std::min(std::max(atoi(value.c_str()), 0), 0xFF);
+    } else if(key == "keys") {
+      for(size_t i = 0; i < 16 && i < value.size(); i++)
+        info.keymap[i] = value[i];
+    } else if(key == "quirks") {
+      std::stringstream ss(value);
+      std::string name;
+      while(std::getline(ss, name, ',')) {
+        bool known = false;
+        for(int q = 0; q < 5; q++) {
+          if(name == quirkNames[q]) {
+            info.quirks |= 1 << q;
+            known = true;
+          }
+        }
+        if(!known)
+          std::cout << path << ": unknown quirk " << name << "\n";
+      }
+    } else {
+      std::cout << path << ": unknown setting " << key << "\n";
+    }
+  }
+  return;
+}
+
+static int build(const std::string &romDir, const char *out, const std::string &colorDir) {
+  DIR *dir = opendir(romDir.c_str());
+  if(!dir) {
+    std::cout << "Error opening " << romDir << "\n";
+    return -1;
+  }
+  std::vector<std::string> names;
+  while(struct dirent *ent = readdir(dir)) {
+    std::string name = ent->d_name;
+    if(endsWith(name, ".ch8") || endsWith(name, ".c8"))
+      names.push_back(name);
+  }
+  closedir(dir);
+  std::sort(names.begin(), names.end());
+
+  std::vector<romInfo> roms;
+  for(size_t i = 0; i < names.size(); i++) {
+    romInfo info;
+    info.name = names[i];
+    info.opsPerSec = 0;
+    info.quirks = 0;
+    info.saveSlots = 0;
+    memset(info.keymap, 0, sizeof(info.keymap));
+    if(!readFile(romDir + "/" + names[i], info.rom) || info.rom.size() > 0xE00) {
+      std::cout << "Skipping " << names[i] << ", unreadable or too large\n";
+      continue;
+    }
+    std::string base = names[i].substr(0, names[i].rfind('.'));
+    readFile(colorDir + "/" + base + ".clr", info.colors);
+    readSettings(romDir + "/" + base + ".cfg", info);
+    roms.push_back(info);
+  }
+  int written = writeRomIndex(out, roms);
+  if(written < 0)
+    return -1;
+  std::cout << "Indexed " << written << " ROMs into " << out << "\n";
+  return 0;
+}
+
+static void printEntry(RomIndex &index, const romEntry *e) {
+  std::cout << std::hex << std::setw(16) << std::setfill('0') << e->hash << std::dec << std::setfill(' ')
+            << "  " << std::setw(5) << e->romSize << "  " << index.getName(e);
+  if(e->colorCount)
+    std::cout << "  colors=" << e->colorCount;
+  if(e->opsPerSec)
+    std::cout << "  ops=" << e->opsPerSec;
+  if(e->quirks) {
+    std::cout << "  quirks=";
+    bool first = true;
+    for(int q = 0; q < 5; q++) {
+      if(e->quirks & (1 << q)) {
+        std::cout << (first ? "" : ",") << quirkNames[q];
+        first = false;
+      }
+    }
+  }
+  if(e->keymap[0])
+    std::cout << "  keys=" << std::string(e->keymap, strnlen(e->keymap, 16));
+  if(e->saveSlots)
+    std::cout << "  saves=" << (int)e->saveSlots;
+  std::cout << "\n";
+  return;
+}
+
+int main(int argc, char **args) {
+  if(argc >= 4 && strcmp(args[1], "build") == 0)
+    return build(args[2], args[3], argc > 4 ? args[4] : "./colors");
+
+  if(argc < 3 || (strcmp(args[1], "list") != 0 && strcmp(args[1], "find") != 0)
+     || (strcmp(args[1], "find") == 0 && argc < 4)) {
+    std::cout << "Usage: chipper-index build <romdir> <out.c8idx> [colordir] | list <index> | find <index> <rom>\n";
+    return -1;
+  }
+  RomIndex index;
+  if(index.open(args[2]))
+    return -1;
+  if(strcmp(args[1], "list") == 0) {
+    for(int i = 0; i < index.getCount(); i++)
+      printEntry(index, index.getEntry(i));
+    return 0;
+  }
+  std::vector<uint8_t> rom;
+  if(!readFile(args[3], rom)) {
+    std::cout << "Error opening ROM " << args[3] << "\n";
+    return -1;
+  }
+  const romEntry *e = index.find(rom.data(), rom.size());
+  if(!e) {
+    std::cout << "Not in the index\n";
+    return 1;
+  }
+  printEntry(index, e);
+  return 0;
+}
@@ -0,0 +1,121 @@
+//chipper-play: plays back a .c8rec recording in a window.
+//Space pauses, Right steps one frame while paused, Tab cycles the scale mode.
+#define SDL_MAIN_HANDLED
+#include <iostream>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <SDL2/SDL.h>
+#include "recorder.h"
+#include "scaler.h"
+
+bool DEBUG_MODE = false;
+bool FIND_MODE = false;
+
+int main(int argc, char **args) {
+  if(argc < 2) {
+    std::cout << "Usage: chipper-play <recording> [scale=<mode>]\n";
+    return -1;
+  }
+  RecordingReader reader;
+  if(reader.open(args[1])) {
+    std::cout << "Error opening recording " << args[1] << "\n";
+    return -1;
+  }
+  Scaler scaler;
+  for(int i = 2; i < argc; i++) {
+    if(strncmp(args[i],"scale=",6) == 0 && !scaler.setModeByName(args[i] + 6))
+      std::cout << "Unknown scale mode " << args[i] + 6 << "\n";
+  }
+
+  if(SDL_Init(SDL_INIT_VIDEO)) {
+    std::cout << "Error initializing SDL\n";
+    return -1;
+  }
+  int WIN_SCALE = 8;
+  SDL_Window* window = SDL_CreateWindow("Chipper - Playback", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, PIX_WIDTH*WIN_SCALE, PIX_HEIGHT*WIN_SCALE, SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
+  SDL_SetWindowMinimumSize(window, PIX_WIDTH, PIX_HEIGHT);
+  SDL_Renderer* renderer = SDL_CreateRenderer(window,-1,SDL_RENDERER_ACCELERATED);
+  SDL_Texture* screen = NULL;
+  int screenW = 0;
+  int screenH = 0;
+  uint32_t background = 0xFF000000 | reader.getPalette()[0];
+
+  recFrame frame;
+  uint32_t argb[PIX_COUNT];
+  bool quit = false;
+  bool paused = false;
+  bool step = false;
+  bool ended = false;
+  bool redraw = true;
+  long frameNumber = 0;
+  double frameMs = 1000.0 / reader.getFps();
+  double nextFrame = SDL_GetTicks();
+  SDL_Event event;
+
+  while(!quit) {
+    while(SDL_PollEvent(&event) != 0) {
+      if(event.type == SDL_QUIT)
+        quit = true;
+      if(event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+        redraw = true;
+      if(event.type == SDL_KEYDOWN && !event.key.repeat) {
+        if(event.key.keysym.scancode == SDL_SCANCODE_SPACE)
+          paused = !paused;
+        if(event.key.keysym.scancode == SDL_SCANCODE_RIGHT)
+          step = true;
+        if(event.key.keysym.scancode == SDL_SCANCODE_TAB) {
+          scaler.setMode((scaler.getMode() + 1) % scale_modes);
+          redraw = true;
+        }
+      }
+    }
+
+    if(!ended && ((!paused && SDL_GetTicks() >= nextFrame) || (paused && step))) {
+      if(reader.next(frame)) {
+        reader.toARGB(frame, argb);
+        frameNumber++;
+        redraw = true;
+        std::string title = "Chipper - Playback | frame " + std::to_string(frameNumber);
+        SDL_SetWindowTitle(window, title.c_str());
+      } else {
+        ended = true;
+        SDL_SetWindowTitle(window, "Chipper - Playback | end");
+      }
+      nextFrame += frameMs;
+      if(paused)
+        nextFrame = SDL_GetTicks();
+      step = false;
+    }
+
+    int outW, outH;
+    SDL_GetRendererOutputSize(renderer, &outW, &outH);
+    if(screen == NULL || outW != screenW || outH != screenH) {
+      if(screen)
+        SDL_DestroyTexture(screen);
+      screen = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, outW, outH);
+      screenW = outW;
+      screenH = outH;
+      redraw = true;
+    }
+    if(redraw && frameNumber > 0) {
+      void *texPixels;
+      int pitch;
+      if(SDL_LockTexture(screen, NULL, &texPixels, &pitch) == 0) {
+        scaler.scale(argb, PIX_WIDTH, PIX_HEIGHT, (uint32_t *)texPixels, screenW, screenH, pitch, background);
+        SDL_UnlockTexture(screen);
+      }
+      redraw = false;
+    }
+    SDL_RenderCopy(renderer, screen, NULL, NULL);
+    SDL_RenderPresent(renderer);
+    SDL_Delay(1);
+  }
+
+  if(screen)
+    SDL_DestroyTexture(screen);
+  SDL_DestroyRenderer(renderer);
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+  return 0;
+}
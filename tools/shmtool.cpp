@@ -0,0 +1,82 @@
+//chipper-shm: example consumer of the shared memory link (chipper ... shm=<name>).
+//  chipper-shm <name> watch          print the screen and registers every frame
+//  chipper-shm <name> regs           print the registers once
+//  chipper-shm <name> keys <mask>    hold keys, bit n = key n (0 releases all)
+//  chipper-shm <name> press <key> <ms>  hold one key (0-F) for ms milliseconds
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include "shm.h"
+
+bool DEBUG_MODE = false;
+bool FIND_MODE = false;
+
+static void printRegs(const shmState &s) {
+  std::cout << "frame " << s.frame << std::hex << std::uppercase
+            << "  PC 0x" << s.regs.pc << "  I 0x" << s.regs.mem_reg
+            << "  SP 0x" << (int)s.regs.sp << "  DT 0x" << (int)s.regs.delay
+            << "  ST 0x" << (int)s.regs.sound << "\n ";
+  for(int i = 0; i < 16; i++)
+    std::cout << " V" << i << "=" << std::setw(2) << std::setfill('0') << (int)s.regs.V[i];
+  std::cout << std::setfill(' ') << std::dec << std::nouppercase << "\n";
+  return;
+}
+
+static void printScreen(const shmState &s) {
+  //read straight from the packed bits
+  for(uint32_t y = 0; y < s.height; y++) {
+    for(uint32_t x = 0; x < s.width; x++) {
+      int i = y * s.width + x;
+      std::cout << ((s.packed[i / 8] & (0x80 >> (i % 8))) ? '#' : ' ');
+    }
+    std::cout << "\n";
+  }
+  return;
+}
+
+int main(int argc, char **args) {
+  if(argc < 3) {
+    std::cout << "Usage: chipper-shm <name> watch|regs|keys <mask>|press <key> <ms>\n";
+    return -1;
+  }
+  ShmLink link;
+  if(link.attach(args[1])) {
+    std::cout << "No chipper is sharing as chipper-" << args[1] << "\n";
+    return -1;
+  }
+
+  shmState state;
+  if(strcmp(args[2], "watch") == 0) {
+    uint64_t lastFrame = 0;
+    while(true) {
+      if(link.read(state) && state.frame != lastFrame) {
+        lastFrame = state.frame;
+        std::cout << "\033[H\033[2J";
+        printRegs(state);
+        printScreen(state);
+        std::cout.flush();
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+  } else if(strcmp(args[2], "regs") == 0) {
+    if(!link.read(state)) {
+      std::cout << "Nothing published yet\n";
+      return -1;
+    }
+    printRegs(state);
+  } else if(strcmp(args[2], "keys") == 0 && argc > 3) {
+    link.setKeys(strtoul(args[3], NULL, 0));
+  } else if(strcmp(args[2], "press") == 0 && argc > 4) {
+    int key = strtol(args[3], NULL, 16) & 0xF;
+    link.setKeys(link.getKeys() | (1 << key));
+    std::this_thread::sleep_for(std::chrono::milliseconds(atoi(args[4])));
+    link.setKeys(link.getKeys() & ~(1 << key));
+  } else {
+    std::cout << "Unknown command " << args[2] << "\n";
+    return -1;
+  }
+  return 0;
+}